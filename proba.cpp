@@ -7,6 +7,47 @@
 #include <algorithm>
 #include <filesystem>
 #include <stdexcept>
+#include <map>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <functional>
+#include <cstring>
+#include <cstdio>
+#include <coroutine>
+#include <utility>
+#include <string_view>
+#include <charconv>
+#include <compare>
+#include <cctype>
+#include <cstdlib>
+#include <new>
+#include <random>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 void createFlow();
@@ -16,474 +57,4266 @@ void runFlow();
 void deleteFlow();
 
 
-class Step {
+// Urmărirea opțională a unei rulări (--trace), în formatul "trace event" din chrome://tracing și
+// Perfetto. Fiecare fir adaugă intervalele în bufferul lui, fără lock-uri; un buffer plin sau al
+// unui fir care se oprește este scris în fișier, deci memoria rămâne mărginită și la rulări lungi
+// (--soak). Când urmărirea este oprită, un interval costă doar un test.
+class Tracer {
 public:
-    bool wasSkipped = false;
-    virtual void execute() = 0;
-    virtual string getDescription() const = 0;
-    virtual string getInfo() const { return ""; }
-};
-
-
+    struct Event {
+        const char* category;
+        string_view name; // text static (ex. typeName)
+        int step;
+        string detail;
+        long long startNs;
+        long long durationNs;
+    };
+
+    static inline atomic<bool> enabled{false};
+
+    static Tracer& instance() {
+        static Tracer tracer;
+        return tracer;
+    }
 
-class TitleStep : public Step {
-    string title;
-    string subtitle;
-public:
-    TitleStep(const string& title, const string& subtitle) 
-        : title(title), subtitle(subtitle) {}
-    void execute() override {
-        cout << "Title: " << title << '\n';
-        cout << "Subtitle: " << subtitle << '\n';
+    ~Tracer() {
+        finish();
     }
-    string getDescription() const override {
-        return  title + "\n" + subtitle;
+
+    void open(const string& tracePath) {
+        lock_guard<mutex> lock(fileMutex);
+        path = tracePath;
+        file.open(path, ios::binary | ios::trunc);
+        if (!file) {
+            cerr << "Could not write trace: " << path << '\n';
+            return;
+        }
+        pid = 1;
+#ifndef _WIN32
+        pid = getpid();
+#endif
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        origin = chrono::steady_clock::now();
+        enabled.store(true);
     }
-    string getInfo() const override {
-        return "Title: " + title; 
+
+    long long now() const {
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - origin).count();
     }
-};
 
-class TextStep : public Step {
-    string title;
-    string copy;
-public:
-    TextStep(const string& title, const string& copy) 
-        : title(title), copy(copy) {}
-    void execute() override {
-        cout << "Title: " << title << '\n';
-        cout << "Copy: " << copy << '\n';
+    void record(Event&& event) {
+        thread_local ThreadBuffer local;
+        if (local.buffer == nullptr) {
+            auto buffer = make_unique<Buffer>();
+            buffer->events.reserve(Buffer::capacity);
+            lock_guard<mutex> lock(buffersMutex);
+            buffer->thread = ++threadCount;
+            buffers.push_back(move(buffer));
+            local.buffer = buffers.back().get();
+        }
+        Buffer& buffer = *local.buffer;
+        buffer.events.push_back(move(event));
+        if (buffer.events.size() == Buffer::capacity) {
+            write(buffer);
+        }
     }
-    string getDescription() const override {
-        return title + "\n" + copy;
+
+    // Scrie intervalele rămase și închide fișierul; firele care le-au înregistrat trebuie să se fi oprit
+    void finish() {
+        if (!enabled.exchange(false)) {
+            return;
+        }
+        {
+            lock_guard<mutex> lock(buffersMutex);
+            for (const auto& buffer : buffers) {
+                write(*buffer);
+            }
+        }
+        lock_guard<mutex> lock(fileMutex);
+        file << "\n]}\n";
+        file.close();
+        cout << "Trace written to " << path << '\n';
     }
-};
 
-class TextInputStep : public Step {
-    string description;
-    string input;
-public:
-    TextInputStep(const string& description) : description(description) {}
-    void execute() override {
-        cout << description << '\n';
-        cout << "Give me a text: ";
-        getline(cin, input);
+private:
+    struct Buffer {
+        static constexpr size_t capacity = 4096;
+        size_t thread = 0;
+        vector<Event> events;
+    };
+
+    // La oprirea firului, intervalele lui sunt scrise și bufferul este eliberat
+    struct ThreadBuffer {
+        Buffer* buffer = nullptr;
+        ~ThreadBuffer() {
+            if (buffer) {
+                Tracer::instance().retire(buffer);
+            }
+        }
+    };
+
+    string path;
+    ofstream file;
+    long long pid = 1;
+    bool first = true;
+    chrono::steady_clock::time_point origin;
+    mutex fileMutex;
+    mutex buffersMutex;
+    vector<unique_ptr<Buffer>> buffers;
+    size_t threadCount = 0;
+
+    void write(Buffer& buffer) {
+        lock_guard<mutex> lock(fileMutex);
+        if (file.is_open()) {
+            char number[64];
+            for (const Event& event : buffer.events) {
+                file << (first ? "\n" : ",\n") << "{\"ph\":\"X\",\"cat\":\"" << event.category << "\",\"name\":";
+                writeString(file, event.name);
+                snprintf(number, sizeof(number), ",\"ts\":%.3f,\"dur\":%.3f", event.startNs / 1000.0, event.durationNs / 1000.0);
+                file << number << ",\"pid\":" << pid << ",\"tid\":" << buffer.thread << ",\"args\":{";
+                if (event.step >= 0) {
+                    file << "\"step\":" << event.step + 1 << (event.detail.empty() ? "" : ",");
+                }
+                if (!event.detail.empty()) {
+                    file << "\"detail\":";
+                    writeString(file, event.detail);
+                }
+                file << "}}";
+                first = false;
+            }
+        }
+        buffer.events.clear();
     }
-    string getDescription() const override {
-        return description;
+
+    void retire(Buffer* buffer) {
+        write(*buffer);
+        lock_guard<mutex> lock(buffersMutex);
+        erase_if(buffers, [buffer](const unique_ptr<Buffer>& b) { return b.get() == buffer; });
     }
-    string getInfo() const override {
-        return input; 
+
+    static void writeString(ostream& out, string_view text) {
+        out << '"';
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                out << '\\' << c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out << escaped;
+            } else {
+                out << c;
+            }
+        }
+        out << '"';
     }
 };
 
-class NumberInputStep : public Step {
-    string description;
-    float input;
+// Un interval urmărit: începe la construcție și se înregistrează la distrugere
+class TraceSpan {
+    const char* category;
+    string_view name;
+    int step;
+    string detail;
+    long long start = 0;
+    bool active;
 public:
-    NumberInputStep(const string& description) : description(description) {}
-    void execute() override {
-        cout << description << endl;
-        cout << "Give me a number: ";
-        cin >> input;
-    }
-    float getInput() const {
-        return input;
+    TraceSpan(const char* category, string_view name, int step = -1)
+        : category(category), name(name), step(step), active(Tracer::enabled.load(memory_order_relaxed)) {
+        if (active) {
+            start = Tracer::instance().now();
+        }
     }
-    string getInfo() const override {
-        return to_string(input);
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+    ~TraceSpan() {
+        if (active) {
+            Tracer& tracer = Tracer::instance();
+            tracer.record({category, name, step, move(detail), start, tracer.now() - start});
+        }
     }
-    string getDescription() const override {
-        return description;
+    void setDetail(string_view text) {
+        if (active) {
+            detail = text;
+        }
     }
 };
 
-template <typename T>
-class CalculusStep : public Step {
-private:
-    const Step* operand1;
-    const Step* operand2;
-    char operation;
 
+// Execuția unui pas este o corutină: un pas care așteaptă date de la utilizator
+// se suspendă și este reluat când sosește răspunsul, fără să blocheze un fir.
+// Corutina pornește doar când este așteptată (co_await) sau pornită explicit cu start().
+class StepTask {
 public:
-    CalculusStep(const Step* op1, const Step* op2, char op) : operand1(op1), operand2(op2), operation(op) {}
+    struct promise_type {
+        coroutine_handle<> continuation = noop_coroutine();
+        exception_ptr exception;
 
-    void execute() override {
-        T value1 = getValueFromStep(*operand1);
-        T value2 = getValueFromStep(*operand2);
-        T result;
-
-        switch (operation) {
-            case '+':
-                result = value1 + value2;
-                break;
-            case '-':
-                result = value1 - value2;
-                break;
-            case '*':
-                result = value1 * value2;
-                break;
-            case '/':
-                if (value2 != 0) {
-                    result = value1 / value2;
-                } else {
-                    throw std::runtime_error("Division by zero");
-                }
-                break;
-            case 'm': // 'm' for min
-                result = std::min(value1, value2);
-                break;
-            case 'M': // 'M' for max
-                result = std::max(value1, value2);
-                break;
-            default:
-                throw std::runtime_error("Invalid operation");
+        StepTask get_return_object() {
+            return StepTask(coroutine_handle<promise_type>::from_promise(*this));
         }
+        suspend_always initial_suspend() noexcept { return {}; }
 
-        std::cout << "Result: " << result << '\n';
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            coroutine_handle<> await_suspend(coroutine_handle<promise_type> h) noexcept {
+                return h.promise().continuation;
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { exception = current_exception(); }
+    };
+
+    StepTask(StepTask&& other) noexcept : handle(exchange(other.handle, nullptr)) {}
+    StepTask& operator=(StepTask&& other) noexcept {
+        if (this != &other) {
+            if (handle) handle.destroy();
+            handle = exchange(other.handle, nullptr);
+        }
+        return *this;
     }
-
-    std::string getDescription() const override {
-        std::ostringstream oss;
-        oss << "CalculusStep " << operation;
-        return oss.str();
+    ~StepTask() {
+        if (handle) handle.destroy();
     }
 
-private:
-    T getValueFromStep(const Step& step) const {
-        std::istringstream iss(step.getInfo());
-        T value;
-        iss >> value;
-
-        return value;
+    // Pornește corutina de pe nivelul cel mai de sus; rulează până la prima suspendare
+    void start() {
+        handle.resume();
     }
-};
-
-class DisplayStep : public Step {
-    string filename;
-public:
-    DisplayStep(const string& filename) : filename(filename) {}
-    void execute() override {
-    const string directoryPath = "fisiere";
-    string name = filename + ".txt";
-    filesystem::path filePath = directoryPath + "/" + name;
-
-    // Verifies if the file exists
-    if (filesystem::exists(filePath)) {
-        ifstream file(filePath);
-        if (!file) {
-            throw runtime_error("Could not open file: " + name);
+    bool done() const {
+        return !handle || handle.done();
+    }
+    void rethrowIfFailed() const {
+        if (handle && handle.promise().exception) {
+            rethrow_exception(handle.promise().exception);
         }
+    }
 
-        string line;
-        while (getline(file, line)) {
-            cout << line << '\n';
-        }
-    } else {
-        throw runtime_error("File does not exist: " + name);
+    bool await_ready() const noexcept {
+        return done();
     }
-}
-    string getDescription() const override {
-        return filename;
+    coroutine_handle<> await_suspend(coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
     }
-    string getInfo() const override {
-        return filename;
+    void await_resume() const {
+        rethrowIfFailed();
     }
+
+private:
+    explicit StepTask(coroutine_handle<promise_type> handle) : handle(handle) {}
+    coroutine_handle<promise_type> handle;
 };
 
-class TextFileInputStep : public Step {
-    string description;
-    string fileName;
-    string fileContent;
+// Sursa răspunsurilor pentru pași: consola sau o sesiune din daemon
+class InputSource {
 public:
-    TextFileInputStep(const string& description) 
-        : description(description) {}
-    void execute() override {
-        cout << "Enter the text file name: \n";
-        cin >> fileName;
+    virtual ~InputSource() = default;
+    // Întoarce true dacă o linie este disponibilă imediat
+    virtual bool tryReadLine(string& line) = 0;
+    // Reia corutina când sosește o linie nouă
+    virtual void waitForLine(coroutine_handle<> awaiting) = 0;
+
+    struct LineAwaiter {
+        InputSource& source;
+        string line;
+        bool ready = false;
+        // Tot timpul cât pasul așteaptă răspunsul, inclusiv citirea blocantă de la consolă
+        TraceSpan wait{"input", "user-wait"};
 
-        if(fileName.find(".txt") == std::string::npos)
-            fileName += ".txt";
+        explicit LineAwaiter(InputSource& source) : source(source) {}
 
-        ofstream file(fileName);
-        if(file.is_open()){
-            cout << "File " << fileName << " is create \n";
-            cout << "Enter the content of the file. When finished, type 'STOP' \n";
-            cin.ignore();
-            while(getline(cin, fileContent)){
-                if(fileContent == "STOP")
-                {
-                    cout << "End of story..";
-                    break;
-                }
-            file << fileContent << endl;
+        bool await_ready() {
+            ready = source.tryReadLine(line);
+            return ready;
+        }
+        void await_suspend(coroutine_handle<> awaiting) {
+            source.waitForLine(awaiting);
+        }
+        string await_resume() {
+            if (!ready && !source.tryReadLine(line)) {
+                throw runtime_error("No input available");
             }
-            cout << "The content is written in file. \n";
+            return move(line);
         }
-        else 
-            cout << "Error creating the file. \n";
-    }
-    string getFileContent() const {
-        return fileContent;
-    }
-    string getDescription() const override {
-        return description;
-    }
-    string getInfo() const override {
-        return fileContent;
+    };
+
+    LineAwaiter readLine() {
+        return LineAwaiter{*this};
     }
-    
 };
 
-class CSVFileInputStep : public Step {
-    string description;
-    string fileName;
-    string fileContent;
-
+// Consola nu se suspendă niciodată: citirea blochează ca înainte
+class ConsoleInput : public InputSource {
 public:
-    CSVFileInputStep(const string& description) 
-        : description(description) {}
-
-    void execute() override {
-        cout << "Enter the csv file name: \n";
-        cin >> fileName;
-
-        if (fileName.find(".csv") == string::npos)
-            fileName += ".csv";
-
-        ofstream file(fileName.c_str());
-
-        if (!file.is_open())
-            cerr << "The file is not open. \n";
-
-        int rows, cols; 
-        cout << "Enter the number of rows: \n";
-        cin >> rows;
-        cout << "Enter the number of cols: \n";
-        cin >> cols;
+    static ConsoleInput& instance() {
+        static ConsoleInput console;
+        return console;
+    }
+    // Golește mai întâi consola, ca întrebarea să fie vizibilă
+    bool tryReadLine(string& line) override;
+    void waitForLine(coroutine_handle<>) override {}
+};
 
-        for (int i = 0; i < rows; ++i) {
-            for (int j = 0; j < cols; ++j){
-                double value;
-                string input;
-                cout << "Enter value in file or 'q' to exit : \n";
-                cin >> input;
+// Rulează sincron o corutină care nu se poate suspenda (ex. pe consolă)
+void runToCompletion(StepTask task) {
+    task.start();
+    if (!task.done()) {
+        throw runtime_error("Step suspended without a scheduler");
+    }
+    task.rethrowIfFailed();
+}
 
-                if (input == "q") {
-                    cout << "Exit \n" << endl;
-                    file.close(); 
-                    return;
-                }
+// Cache LRU, comun tuturor rulărilor, pentru rezultatele pașilor deterministici.
+// Capacitatea 0 îl dezactivează; contorizează hit-urile și miss-urile pe tip de pas.
+class StepCache {
+    struct Stats {
+        long long hits = 0;
+        long long misses = 0;
+        long long prefetched = 0; // ratări acoperite de prefetch, incluse în misses
+    };
+    struct Entry {
+        string key;
+        string value;
+        bool prefetched = false; // adus de prefetch și încă necerut de pas
+    };
+    size_t capacity = 0;
+    list<Entry> entries;
+    unordered_map<string, list<Entry>::iterator> index;
+    map<string, Stats> stats;
+    mutable mutex m;
 
-                istringstream iss(input);
-                iss >> value;
+public:
+    void setCapacity(size_t entriesCount) {
+        lock_guard<mutex> lock(m);
+        capacity = entriesCount;
+        while (entries.size() > capacity) {
+            index.erase(entries.back().key);
+            entries.pop_back();
+        }
+    }
 
-                file << value;
+    bool enabled() const {
+        lock_guard<mutex> lock(m);
+        return capacity > 0;
+    }
 
-                if (j < cols - 1)
-                    file << ",";
-            }
-            file << " ";
-            file << endl;
+    bool lookup(const string& stepType, const string& key, string& value) {
+        lock_guard<mutex> lock(m);
+        auto it = index.find(key);
+        if (it == index.end()) {
+            stats[stepType].misses++;
+            return false;
         }
-
-        cout << "The CSV file is created: " << fileName << endl;
-        file.close();
+        entries.splice(entries.begin(), entries, it->second);
+        value = it->second->value;
+        // Prima cerere a unei valori aduse de prefetch ar fi fost o ratare fără el
+        Stats& stepStats = stats[stepType];
+        if (it->second->prefetched) {
+            it->second->prefetched = false;
+            stepStats.misses++;
+            stepStats.prefetched++;
+        } else {
+            stepStats.hits++;
+        }
+        return true;
     }
 
-    string getFileContent() const {
-        return fileContent;
+    // Fără statistici și fără să schimbe ordinea LRU, pentru prefetch
+    bool contains(const string& key) const {
+        lock_guard<mutex> lock(m);
+        return index.count(key) > 0;
     }
 
-    string getDescription() const override {
-        return description;
+    void store(const string& key, const string& value, bool prefetched = false) {
+        lock_guard<mutex> lock(m);
+        if (capacity == 0) {
+            return;
+        }
+        auto it = index.find(key);
+        if (it != index.end()) {
+            if (prefetched) {
+                return; // Deja în cache, prefetch-ul nu schimbă nimic
+            }
+            it->second->value = value;
+            entries.splice(entries.begin(), entries, it->second);
+            return;
+        }
+        entries.push_front(Entry{key, value, prefetched});
+        index[key] = entries.begin();
+        if (entries.size() > capacity) {
+            index.erase(entries.back().key);
+            entries.pop_back();
+        }
     }
 
-    string getInfo() const override {
-        return fileContent;
+    void printStats(ostream& out = cout) const {
+        lock_guard<mutex> lock(m);
+        out << "Memoization (" << entries.size() << "/" << capacity << " entries):\n";
+        for (const auto& entry : stats) {
+            long long total = entry.second.hits + entry.second.misses;
+            out << "  " << entry.first << ": " << entry.second.hits << " hits, "
+                << entry.second.misses << " misses";
+            if (entry.second.prefetched) {
+                out << " (" << entry.second.prefetched << " loaded by prefetch)";
+            }
+            out << ", hit rate "
+                << (total ? 100.0 * entry.second.hits / total : 0.0) << "%\n";
+        }
     }
 };
 
-class OutputStep : public Step {
-private:
-    int step;
-    string fileName;
-    string title;
-    string description;
-    Step& previousStep;
-
-public:
-    OutputStep(int step, const string& fileName, const string& title, const string& description, Step& previousStep)
-        : step(step), fileName(fileName), title(title), description(description), previousStep(previousStep) {}
-
-    void execute() override {
+// Momentul ultimei modificări a unui fișier, folosit în cheile cache-ului
+long long modificationTime(const filesystem::path& path) {
+    error_code ec;
+    auto time = filesystem::last_write_time(path, ec);
+    return ec ? -1 : static_cast<long long>(time.time_since_epoch().count());
+}
 
-        if(fileName.find(".txt") == std::string::npos)
-            fileName += ".txt";
+// Cere sistemului să aducă fișierul în memorie (readahead) în fundal, fără să îl citească aici
+void adviseWillNeed(const string& path) {
+#ifndef _WIN32
+    if (path.empty()) {
+        return;
+    }
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+#ifdef POSIX_FADV_WILLNEED
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+    close(fd);
+#endif
+}
 
-        ofstream file(fileName);
-        if (!file.is_open()) {
-            throw runtime_error("Could not open file: " + fileName);}
-        
-        file << "File Name: " << fileName << '\n';
-        file << "Title: " << title << '\n';
-        file << "Description: " << description << '\n';
-        file << "Information from step " << step << ": " << previousStep.getInfo() << '\n';
+// Destinația textului unui pas: primește bucăți (string_view) fără stringuri intermediare
+class TextSink {
+public:
+    virtual ~TextSink() = default;
+    virtual void write(string_view text) = 0;
 
-        cout << "Open file for detail, file name: " << fileName << "\n";
-        
+    TextSink& operator<<(string_view text) {
+        write(text);
+        return *this;
+    }
+    TextSink& operator<<(char c) {
+        write(string_view(&c, 1));
+        return *this;
+    }
+    TextSink& operator<<(int value) {
+        return *this << static_cast<long long>(value);
+    }
+    TextSink& operator<<(long long value) {
+        char buffer[24];
+        auto result = to_chars(buffer, buffer + sizeof(buffer), value);
+        write(string_view(buffer, result.ptr - buffer));
+        return *this;
     }
+    TextSink& operator<<(double value) {
+        // %g formatează la fel ca operator<< implicit al fluxurilor
+        char buffer[32];
+        int length = snprintf(buffer, sizeof(buffer), "%g", value);
+        write(string_view(buffer, length));
+        return *this;
+    }
+};
 
-    string getDescription() const override {
-        return to_string(step) + "\n" + fileName + "\n" + title + "\n" + description + "\n" + previousStep.getInfo();
+// Scrie direct în bufferul unui flux (fișier sau consolă)
+class StreamSink : public TextSink {
+    ostream& out;
+public:
+    explicit StreamSink(ostream& out) : out(out) {}
+    void write(string_view text) override {
+        out.write(text.data(), text.size());
     }
 };
 
-class EndStep : public Step {
+// Scrie într-un buffer dat de apelant; ce nu încape este trunchiat, iar overflowed() spune asta
+class BufferSink : public TextSink {
+    char* data;
+    size_t capacity;
+    size_t length = 0;
+    bool overflow = false;
 public:
-    void execute() override {
-        cout << "End of flow.\n";
+    BufferSink(char* data, size_t capacity) : data(data), capacity(capacity) {}
+    void write(string_view text) override {
+        size_t count = min(text.size(), capacity - length);
+        memcpy(data + length, text.data(), count);
+        length += count;
+        overflow = overflow || count < text.size();
     }
-    string getDescription() const override {
-        return "End step";
+    string_view view() const { return string_view(data, length); }
+    bool overflowed() const { return overflow; }
+    void clear() { length = 0; overflow = false; }
+};
+
+// Pentru codul care are nevoie de un string propriu
+class StringSink : public TextSink {
+    string text;
+public:
+    void write(string_view part) override {
+        text.append(part);
     }
+    string str() && { return move(text); }
 };
 
-class Analytics {
-    int timesStarted = 0;
-    int timesCompleted = 0;
-    int* skipCounts;
-    int* errorCounts;
-    int skipCountsSize;
+// Destinația a tot ce afișează pașii. Ieșirea nu se golește la fiecare linie,
+// ci doar când cineva are nevoie de ea (ex. înainte de a aștepta un răspuns).
+class OutputSink : public TextSink {
 public:
-    Analytics(int maxSteps) : skipCountsSize(maxSteps) {
-        skipCounts = new int[skipCountsSize]();
-        errorCounts = new int[skipCountsSize]();
+    virtual void flush() {}
+};
+
+// Consola, cu un buffer propriu golit când se umple sau înainte de citirea de la tastatură
+class TerminalSink : public OutputSink {
+    char buffer[8192];
+    size_t length = 0;
+public:
+    static TerminalSink& instance() {
+        static TerminalSink terminal;
+        return terminal;
     }
-    ~Analytics() {
-        delete[] skipCounts;
-        delete[] errorCounts;
+    ~TerminalSink() override {
+        flush();
     }
-    void start() { timesStarted++; }
-    void complete() { timesCompleted++; }
-    void skip(int stepIndex) { skipCounts[stepIndex]++; }
-    void error(int stepIndex) { errorCounts[stepIndex]++; } 
-    void print() const {
-        cout << "Times started: " << timesStarted << '\n';
-        cout << "Times completed: " << timesCompleted << '\n';
-        cout << "Skip counts:\n";
-        for (int i = 0; i < skipCountsSize; i++) {
-            cout << "  Step " << (i + 1) << ": " << skipCounts[i] << '\n';
+    void write(string_view text) override {
+        if (length + text.size() > sizeof(buffer)) {
+            flush();
+            if (text.size() > sizeof(buffer)) {
+                cout.write(text.data(), text.size());
+                return;
+            }
         }
-        cout << "Error counts:\n";
-        for (int i = 0; i < skipCountsSize; i++) {
-            cout << "  Step " << (i + 1) << ": " << errorCounts[i] << '\n';
+        memcpy(buffer + length, text.data(), text.size());
+        length += text.size();
+    }
+    void flush() override {
+        if (length > 0) {
+            cout.write(buffer, length);
+            length = 0;
         }
+        cout.flush();
     }
+};
 
+// Păstrează în memorie tot ce s-a afișat, pentru teste
+class CaptureSink : public OutputSink {
+    string text;
+public:
+    void write(string_view part) override {
+        text.append(part);
+    }
+    const string& str() const { return text; }
+    void clear() { text.clear(); }
 };
 
-class Flow {
-private:
-    Step** steps;
-    int stepCount;
-    int stepCapacity;
-    string name;
-    time_t timestamp;
-    Analytics analytics;
+// Aruncă tot; pentru benchmark-uri și replay, unde contează doar logica pașilor
+class NullSink : public OutputSink {
+public:
+    void write(string_view) override {}
+};
 
+bool ConsoleInput::tryReadLine(string& line) {
+    TerminalSink::instance().flush();
+    if (!getline(cin, line)) {
+        throw runtime_error("End of input");
+    }
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+    return true;
+}
 
+// Starea unui pas în formă binară compactă, pentru checkpoint-uri. Numerele sunt scrise
+// în ordinea octeților mașinii: un checkpoint este reluat pe aceeași mașină.
+class StateWriter {
+    string data;
 public:
-    Flow(const string& name, int maxSteps) : name(name), timestamp(time(nullptr)), stepCount(0), stepCapacity(maxSteps), analytics(maxSteps)  {
-        steps = new Step*[stepCapacity];
+    void writeInt(uint32_t value) {
+        data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+    void writeLong(uint64_t value) {
+        data.append(reinterpret_cast<const char*>(&value), sizeof(value));
     }
+    void writeFloat(float value) {
+        data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+    void writeString(string_view text) {
+        writeInt(text.size());
+        data.append(text);
+    }
+    const string& bytes() const { return data; }
+    void clear() { data.clear(); }
+};
 
-    ~Flow() {
+class StateReader {
+    string_view data;
+
+    void read(void* value, size_t size) {
+        if (data.size() < size) {
+            throw runtime_error("Truncated step state");
+        }
+        memcpy(value, data.data(), size);
+        data.remove_prefix(size);
+    }
+public:
+    explicit StateReader(string_view data) : data(data) {}
+    uint32_t readInt() {
+        uint32_t value;
+        read(&value, sizeof(value));
+        return value;
+    }
+    uint64_t readLong() {
+        uint64_t value;
+        read(&value, sizeof(value));
+        return value;
+    }
+    float readFloat() {
+        float value;
+        read(&value, sizeof(value));
+        return value;
+    }
+    string readString() {
+        uint32_t size = readInt();
+        string text(size, '\0');
+        read(text.data(), size);
+        return text;
+    }
+};
+
+struct BatchRun;
+
+class Step {
+public:
+    virtual ~Step() = default;
+    bool wasSkipped = false;
+    // Sursa răspunsurilor și fluxul de afișare; implicit consola, altfel sesiunea care rulează flowul
+    InputSource* in = &ConsoleInput::instance();
+    OutputSink* out = &TerminalSink::instance();
+    // Cache-ul pentru memoizare; Flow îl dă doar pașilor deterministici
+    StepCache* cache = nullptr;
+    // Directorul în care pasul scrie fișierele; gol = directorul curent
+    string outputDirectory;
+    virtual StepTask execute() = 0;
+    // Un pas determinist depinde doar de datele lui și de fișierele citite, niciodată de cin;
+    // doar pașii care citesc fișiere îl declară, pentru ei memoizarea merită
+    virtual bool isDeterministic() const { return false; }
+    // Modul batch: pașii fără date de la utilizator rulează o singură dată, ceilalți își suprascriu varianta
+    virtual void runBatch(BatchRun& batch, int stepIndex);
+    // Pasul primește în modul batch o coloană din datele de intrare
+    virtual bool isBatchInput() const { return false; }
+    // Numele pasului din formatul fișierelor de flow
+    virtual string_view typeName() const = 0;
+    // O copie nerulată a pasului; steps sunt pașii deja copiați ai flowului nou, unde
+    // sunt căutați pașii referiți după poziție
+    virtual Step* clone(Step* const* steps) const = 0;
+    // Textul salvat în fișier după nume; se scrie direct în sink, fără alocări
+    virtual void describe(TextSink& sink) const = 0;
+    // Doar definiția pasului, fără valori produse la rulare; implicit aceeași cu describe
+    virtual void describeDefinition(TextSink& sink) const { describe(sink); }
+    // Valoarea produsă de pas, folosită de pașii care îl referă
+    virtual void writeInfo(TextSink&) const {}
+    // Valoarea folosită în calcule; implicit aceeași, dar fără rotunjirile afișării
+    virtual void writeValue(TextSink& sink) const { writeInfo(sink); }
+    // Ce a produs execuția pasului, salvat în checkpoint și refăcut la reluarea rulării
+    virtual void saveState(StateWriter&) const {}
+    virtual void restoreState(StateReader&) {}
+    // Fișierul pe care îl va citi pasul, dacă se știe înainte de execuție; altfel gol
+    virtual string inputFile() const { return {}; }
+    // Apelat pe firul de prefetch, înainte ca rularea să ajungă la pas
+    virtual void prefetch() const { adviseWillNeed(inputFile()); }
+
+    // Calea unui fișier scris de pas
+    string outputPath(const string& fileName) const {
+        return outputDirectory.empty() ? fileName : outputDirectory + "/" + fileName;
+    }
+
+    string getDescription() const {
+        StringSink sink;
+        describe(sink);
+        return move(sink).str();
+    }
+    string getInfo() const {
+        StringSink sink;
+        writeInfo(sink);
+        return move(sink).str();
+    }
+};
+
+// Rularea unui flow pe toate rândurile unui set de date, coloană cu coloană:
+// fiecare pas care produce o valoare primește o coloană cu valoarea lui pe fiecare rând
+struct BatchRun {
+    struct Column {
+        vector<string> text;
+        vector<double> numbers;
+    };
+    size_t rows = 0;
+    map<int, vector<string>> bindings; // indexul pasului (de la 0) -> coloana din datele de intrare
+    map<const Step*, Column> columns;
+    int errors = 0;
+
+    const vector<string>& bound(int stepIndex) const {
+        auto it = bindings.find(stepIndex);
+        if (it == bindings.end()) {
+            throw runtime_error("Step " + to_string(stepIndex + 1) + " needs input but is not bound to a column");
+        }
+        return it->second;
+    }
+
+    // Valorile numerice ale unui pas, convertite o singură dată din text dacă e nevoie
+    const vector<double>& numbers(const Step* step) {
+        auto it = columns.find(step);
+        if (it == columns.end()) {
+            throw runtime_error("Operand step has no value in batch mode");
+        }
+        Column& column = it->second;
+        if (column.numbers.size() != rows) {
+            column.numbers.resize(rows);
+            for (size_t r = 0; r < rows; r++) {
+                column.numbers[r] = strtod(column.text[r].c_str(), nullptr);
+            }
+        }
+        return column.numbers;
+    }
+
+    // Valorile text ale unui pas, formatate o singură dată din numere dacă e nevoie
+    const vector<string>& text(const Step* step) {
+        auto it = columns.find(step);
+        if (it == columns.end()) {
+            static const vector<string> none;
+            return none;
+        }
+        Column& column = it->second;
+        if (column.text.size() != rows) {
+            column.text.resize(rows);
+            char buffer[32];
+            for (size_t r = 0; r < rows; r++) {
+                // Cea mai scurtă formă exactă, ca Numeric<double>::write
+                auto result = to_chars(buffer, buffer + sizeof(buffer), column.numbers[r]);
+                column.text[r].assign(buffer, result.ptr - buffer);
+            }
+        }
+        return column.text;
+    }
+};
+
+void Step::runBatch(BatchRun&, int) {
+    runToCompletion(execute());
+}
+
+
+
+class TitleStep : public Step {
+    string title;
+    string subtitle;
+public:
+    TitleStep(const string& title, const string& subtitle) 
+        : title(title), subtitle(subtitle) {}
+    StepTask execute() override {
+        *out << "Title: " << title << '\n';
+        *out << "Subtitle: " << subtitle << '\n';
+        co_return;
+    }
+    string_view typeName() const override { return "TitleStep"; }
+    Step* clone(Step* const*) const override { return new TitleStep(title, subtitle); }
+    void describe(TextSink& sink) const override {
+        sink << title << '\n' << subtitle;
+    }
+    void writeInfo(TextSink& sink) const override {
+        sink << "Title: " << title;
+    }
+};
+
+class TextStep : public Step {
+    string title;
+    string copy;
+public:
+    TextStep(const string& title, const string& copy) 
+        : title(title), copy(copy) {}
+    StepTask execute() override {
+        *out << "Title: " << title << '\n';
+        *out << "Copy: " << copy << '\n';
+        co_return;
+    }
+    string_view typeName() const override { return "TextStep"; }
+    Step* clone(Step* const*) const override { return new TextStep(title, copy); }
+    void describe(TextSink& sink) const override {
+        sink << title << '\n' << copy;
+    }
+};
+
+class TextInputStep : public Step {
+    string description;
+    string input;
+public:
+    TextInputStep(const string& description) : description(description) {}
+    StepTask execute() override {
+        *out << description << '\n';
+        *out << "Give me a text: ";
+        input = co_await in->readLine();
+    }
+    void runBatch(BatchRun& batch, int stepIndex) override {
+        batch.columns[this].text = batch.bound(stepIndex);
+    }
+    bool isBatchInput() const override { return true; }
+    string_view typeName() const override { return "TextInputStep"; }
+    Step* clone(Step* const*) const override { return new TextInputStep(description); }
+    void describe(TextSink& sink) const override {
+        sink << description;
+    }
+    void writeInfo(TextSink& sink) const override {
+        sink << input;
+    }
+    void saveState(StateWriter& state) const override {
+        state.writeString(input);
+    }
+    void restoreState(StateReader& state) override {
+        input = state.readString();
+    }
+};
+
+class NumberInputStep : public Step {
+    string description;
+    float input = 0;
+    string typed; // textul introdus, ca un CalculusStep zecimal să nu treacă prin float
+public:
+    NumberInputStep(const string& description) : description(description) {}
+    StepTask execute() override {
+        *out << description << '\n';
+        *out << "Give me a number: ";
+        istringstream iss(co_await in->readLine());
+        iss >> input;
+        iss.clear();
+        iss.seekg(0);
+        typed.clear();
+        iss >> typed;
+    }
+    void runBatch(BatchRun& batch, int stepIndex) override {
+        BatchRun::Column& column = batch.columns[this];
+        column.text = batch.bound(stepIndex);
+        batch.numbers(this);
+    }
+    bool isBatchInput() const override { return true; }
+    float getInput() const {
+        return input;
+    }
+    void writeInfo(TextSink& sink) const override {
+        // Același format ca to_string(float)
+        char buffer[64];
+        int length = snprintf(buffer, sizeof(buffer), "%f", input);
+        sink << string_view(buffer, length);
+    }
+    void writeValue(TextSink& sink) const override {
+        if (typed.empty()) {
+            writeInfo(sink);
+        } else {
+            sink << typed;
+        }
+    }
+    string_view typeName() const override { return "NumberInputStep"; }
+    Step* clone(Step* const*) const override { return new NumberInputStep(description); }
+    void describe(TextSink& sink) const override {
+        sink << description;
+    }
+    void saveState(StateWriter& state) const override {
+        state.writeFloat(input);
+        state.writeString(typed);
+    }
+    void restoreState(StateReader& state) override {
+        input = state.readFloat();
+        typed = state.readString();
+    }
+};
+
+// Număr zecimal cu virgulă fixă: exact până la 6 zecimale, păstrat ca întreg (valoarea * 10^6).
+// Înmulțirea și împărțirea rotunjesc la a 6-a zecimală (jumătatea se rotunjește în sus, în modul).
+struct Decimal {
+    static constexpr int64_t scale = 1000000;
+    static constexpr int digits = 6;
+    int64_t units = 0;
+
+    static __int128 divideRounded(__int128 numerator, __int128 denominator) {
+        __int128 quotient = numerator / denominator;
+        __int128 remainder = numerator % denominator;
+        if (2 * (remainder < 0 ? -remainder : remainder) >= (denominator < 0 ? -denominator : denominator)) {
+            quotient += (numerator < 0) != (denominator < 0) ? -1 : 1;
+        }
+        return quotient;
+    }
+
+    // Calculele se fac pe 128 de biți; un rezultat care nu încape în int64 este o eroare a pasului
+    static Decimal checked(__int128 units) {
+        if (units > numeric_limits<int64_t>::max() || units < numeric_limits<int64_t>::min()) {
+            throw runtime_error("Decimal value out of range");
+        }
+        return {static_cast<int64_t>(units)};
+    }
+
+    friend Decimal operator+(Decimal a, Decimal b) { return checked(static_cast<__int128>(a.units) + b.units); }
+    friend Decimal operator-(Decimal a, Decimal b) { return checked(static_cast<__int128>(a.units) - b.units); }
+    friend Decimal operator*(Decimal a, Decimal b) {
+        return checked(divideRounded(static_cast<__int128>(a.units) * b.units, scale));
+    }
+    friend Decimal operator/(Decimal a, Decimal b) {
+        return checked(divideRounded(static_cast<__int128>(a.units) * scale, b.units));
+    }
+    friend auto operator<=>(Decimal a, Decimal b) = default;
+};
+
+// Citirea și scrierea valorilor fiecărui tip numeric din/în textul pașilor (getInfo)
+template <typename T>
+struct Numeric;
+
+// from_chars nu acceptă "+" în față, pe care utilizatorul îl poate tasta. Un text fără cifre
+// sau în afara intervalului tipului este o eroare a pasului, nu valoarea 0.
+template <typename T>
+T parseNumber(string_view text, const char* outOfRange) {
+    string_view digits = text;
+    if (!digits.empty() && digits[0] == '+') {
+        digits.remove_prefix(1);
+    }
+    T value{};
+    auto result = from_chars(digits.data(), digits.data() + digits.size(), value);
+    if (result.ec == errc::result_out_of_range) {
+        throw runtime_error(outOfRange);
+    }
+    if (result.ec != errc()) {
+        throw runtime_error("Not a number: " + string(text));
+    }
+    return value;
+}
+
+template <>
+struct Numeric<float> {
+    static constexpr string_view name = "float";
+    static float parse(string_view text) {
+        return parseNumber<float>(text, "Number out of range");
+    }
+    // Cea mai scurtă formă care se citește înapoi în aceeași valoare, nu doar 6 cifre ca %g
+    static void write(TextSink& sink, float value) {
+        char buffer[32];
+        auto result = to_chars(buffer, buffer + sizeof(buffer), value);
+        sink << string_view(buffer, result.ptr - buffer);
+    }
+};
+
+template <>
+struct Numeric<double> {
+    static constexpr string_view name = "double";
+    static double parse(string_view text) {
+        return parseNumber<double>(text, "Number out of range");
+    }
+    static void write(TextSink& sink, double value) {
+        char buffer[32];
+        auto result = to_chars(buffer, buffer + sizeof(buffer), value);
+        sink << string_view(buffer, result.ptr - buffer);
+    }
+};
+
+template <>
+struct Numeric<int64_t> {
+    static constexpr string_view name = "int64";
+    // "5.000000" (un NumberInputStep) devine 5; partea zecimală este trunchiată. Un exponent
+    // oriunde în text ("1.5e+20", scris de pașii float și double) trece prin double.
+    static int64_t parse(string_view text) {
+        if (text.find_first_of("eE") != string_view::npos) {
+            double scientific = Numeric<double>::parse(text);
+            if (!(fabs(scientific) < 9.2e18)) {
+                throw runtime_error("Integer value out of range");
+            }
+            return static_cast<int64_t>(scientific);
+        }
+        return parseNumber<int64_t>(text, "Integer value out of range");
+    }
+    static void write(TextSink& sink, int64_t value) { sink << static_cast<long long>(value); }
+};
+
+template <>
+struct Numeric<Decimal> {
+    static constexpr string_view name = "decimal";
+    // Cifrele sunt citite direct, fără să treacă prin double; după a 6-a zecimală se rotunjește
+    static Decimal parse(string_view text) {
+        if (text.find_first_of("eE") != string_view::npos) {
+            double scaled = Numeric<double>::parse(text) * Decimal::scale;
+            if (!(fabs(scaled) < 9.2e18)) {
+                throw runtime_error("Decimal value out of range");
+            }
+            return {llround(scaled)};
+        }
+        size_t i = 0;
+        bool negative = i < text.size() && text[i] == '-';
+        if (i < text.size() && (text[i] == '-' || text[i] == '+')) {
+            i++;
+        }
+        size_t first = i;
+        __int128 units = 0;
+        for (; i < text.size() && isdigit(static_cast<unsigned char>(text[i])); i++) {
+            units = units * 10 + (text[i] - '0');
+            if (units > numeric_limits<int64_t>::max()) {
+                throw runtime_error("Decimal value out of range");
+            }
+        }
+        units *= Decimal::scale;
+        bool digits = i > first;
+        if (i < text.size() && text[i] == '.') {
+            i++;
+            digits = digits || (i < text.size() && isdigit(static_cast<unsigned char>(text[i])));
+            int64_t place = Decimal::scale / 10;
+            for (; i < text.size() && isdigit(static_cast<unsigned char>(text[i])); i++) {
+                if (place > 0) {
+                    units += (text[i] - '0') * place;
+                    place /= 10;
+                } else {
+                    units += text[i] >= '5' ? 1 : 0;
+                    break;
+                }
+            }
+        }
+        if (!digits) {
+            throw runtime_error("Not a number: " + string(text));
+        }
+        return Decimal::checked(negative ? -units : units);
+    }
+    static void write(TextSink& sink, Decimal value) {
+        uint64_t magnitude = value.units < 0 ? -static_cast<uint64_t>(value.units) : value.units;
+        if (value.units < 0) {
+            sink << '-';
+        }
+        sink << static_cast<long long>(magnitude / Decimal::scale);
+        uint64_t fraction = magnitude % Decimal::scale;
+        if (fraction != 0) {
+            char buffer[Decimal::digits + 1];
+            buffer[0] = '.';
+            for (int d = Decimal::digits; d >= 1; d--) {
+                buffer[d] = '0' + fraction % 10;
+                fraction /= 10;
+            }
+            int length = Decimal::digits + 1;
+            while (buffer[length - 1] == '0') {
+                length--;
+            }
+            sink << string_view(buffer, length);
+        }
+    }
+};
+
+// Operațiile unui CalculusStep, alese o singură dată la încărcare prin tipul pasului
+// Depășirea întregilor este raportată ca eroare a pasului; Decimal o verifică în operatorii lui
+[[noreturn]] inline void integerOverflow() {
+    throw runtime_error("Integer overflow");
+}
+
+template <typename T>
+struct Plus {
+    static constexpr char symbol = '+';
+    static constexpr bool canFail = !is_floating_point_v<T>;
+    T operator()(T a, T b) const {
+        if constexpr (is_integral_v<T>) {
+            T sum;
+            if (__builtin_add_overflow(a, b, &sum)) {
+                integerOverflow();
+            }
+            return sum;
+        } else {
+            return a + b;
+        }
+    }
+};
+template <typename T>
+struct Minus {
+    static constexpr char symbol = '-';
+    static constexpr bool canFail = !is_floating_point_v<T>;
+    T operator()(T a, T b) const {
+        if constexpr (is_integral_v<T>) {
+            T difference;
+            if (__builtin_sub_overflow(a, b, &difference)) {
+                integerOverflow();
+            }
+            return difference;
+        } else {
+            return a - b;
+        }
+    }
+};
+template <typename T>
+struct Times {
+    static constexpr char symbol = '*';
+    static constexpr bool canFail = !is_floating_point_v<T>;
+    T operator()(T a, T b) const {
+        if constexpr (is_integral_v<T>) {
+            T product;
+            if (__builtin_mul_overflow(a, b, &product)) {
+                integerOverflow();
+            }
+            return product;
+        } else {
+            return a * b;
+        }
+    }
+};
+template <typename T>
+struct Divide {
+    static constexpr char symbol = '/';
+    static constexpr bool canFail = true; // împărțirea la zero
+    T operator()(T a, T b) const {
+        if (b == T{}) {
+            throw runtime_error("Division by zero");
+        }
+        if constexpr (is_integral_v<T>) {
+            if (a == numeric_limits<T>::min() && b == T(-1)) {
+                integerOverflow();
+            }
+        }
+        return a / b;
+    }
+};
+template <typename T>
+struct Min {
+    static constexpr char symbol = 'm'; // 'm' for min
+    static constexpr bool canFail = false;
+    T operator()(T a, T b) const { return std::min(a, b); }
+};
+template <typename T>
+struct Max {
+    static constexpr char symbol = 'M'; // 'M' for max
+    static constexpr bool canFail = false;
+    T operator()(T a, T b) const { return std::max(a, b); }
+};
+
+template <typename T, typename Operation>
+class CalculusStep : public Step {
+private:
+    const Step* operand1;
+    const Step* operand2;
+    // Pozițiile operanzilor în flow (de la 1), pentru salvare
+    int operand1Index;
+    int operand2Index;
+    T result{};
+
+public:
+    CalculusStep(const Step* op1, const Step* op2, int index1, int index2)
+        : operand1(op1), operand2(op2), operand1Index(index1), operand2Index(index2) {}
+
+    // Nu este memoizat: o operație costă mai puțin decât cheia și căutarea în cache
+    StepTask execute() override {
+        result = Operation{}(getValueFromStep(*operand1), getValueFromStep(*operand2));
+
+        *out << "Result: ";
+        Numeric<T>::write(*out, result);
+        *out << '\n';
+        co_return;
+    }
+
+    void runBatch(BatchRun& batch, int) override {
+        size_t rows = batch.rows;
+        if constexpr (is_same_v<T, Decimal>) {
+            // Valorile exacte vin din text, nu din coloanele double
+            const vector<string>& a = batch.text(operand1);
+            const vector<string>& b = batch.text(operand2);
+            if (a.size() != rows || b.size() != rows) {
+                throw runtime_error("Operand step has no value in batch mode");
+            }
+            vector<string>& column = batch.columns[this].text;
+            column.resize(rows);
+            char buffer[48];
+            for (size_t r = 0; r < rows; r++) {
+                Decimal z;
+                try {
+                    z = Operation{}(Numeric<T>::parse(a[r]), Numeric<T>::parse(b[r]));
+                } catch (const exception&) {
+                    // Împărțire la zero sau valoare în afara intervalului
+                    column[r] = "nan";
+                    batch.errors++;
+                    continue;
+                }
+                BufferSink sink(buffer, sizeof(buffer));
+                Numeric<T>::write(sink, z);
+                column[r].assign(sink.view());
+            }
+        } else {
+            // O buclă simplă pe toate rândurile; doar operațiile care pot eșua (împărțirea,
+            // depășirea întregilor) au un try, care nu costă nimic cât timp nu se aruncă
+            const vector<double>& a = batch.numbers(operand1);
+            const vector<double>& b = batch.numbers(operand2);
+            vector<double>& column = batch.columns[this].numbers;
+            column.resize(rows);
+            for (size_t r = 0; r < rows; r++) {
+                if constexpr (is_integral_v<T>) {
+                    // Conversia unui double care nu încape în int64 ar fi nedefinită
+                    if (!(fabs(a[r]) < 9.2e18) || !(fabs(b[r]) < 9.2e18)) {
+                        column[r] = NAN;
+                        batch.errors++;
+                        continue;
+                    }
+                }
+                T x = static_cast<T>(a[r]);
+                T y = static_cast<T>(b[r]);
+                if constexpr (Operation::canFail) {
+                    try {
+                        column[r] = static_cast<double>(Operation{}(x, y));
+                    } catch (const exception&) {
+                        column[r] = NAN;
+                        batch.errors++;
+                    }
+                } else {
+                    column[r] = static_cast<double>(Operation{}(x, y));
+                }
+            }
+        }
+    }
+
+    string_view typeName() const override { return "CalculusStep"; }
+    Step* clone(Step* const* steps) const override {
+        return new CalculusStep(steps[operand1Index - 1], steps[operand2Index - 1], operand1Index, operand2Index);
+    }
+    void describe(TextSink& sink) const override {
+        sink << Operation::symbol << ' ' << operand1Index << ' ' << operand2Index << ' ' << Numeric<T>::name;
+    }
+    void writeInfo(TextSink& sink) const override {
+        Numeric<T>::write(sink, result);
+    }
+    void saveState(StateWriter& state) const override {
+        state.writeString(string_view(reinterpret_cast<const char*>(&result), sizeof(result)));
+    }
+    void restoreState(StateReader& state) override {
+        string bytes = state.readString();
+        if (bytes.size() != sizeof(result)) {
+            throw runtime_error("Invalid CalculusStep state");
+        }
+        memcpy(&result, bytes.data(), sizeof(result));
+    }
+
+private:
+    // Textul operandului este scris pe stivă, fără alocări
+    T getValueFromStep(const Step& step) const {
+        char buffer[128];
+        BufferSink sink(buffer, sizeof(buffer));
+        step.writeValue(sink);
+        string_view text = sink.view();
+        size_t first = text.find_first_not_of(" \t");
+        return Numeric<T>::parse(first == string_view::npos ? string_view() : text.substr(first));
+    }
+};
+
+template <typename T>
+Step* makeCalculusStep(char operation, const Step* op1, const Step* op2, int index1, int index2) {
+    switch (operation) {
+        case '+': return new CalculusStep<T, Plus<T>>(op1, op2, index1, index2);
+        case '-': return new CalculusStep<T, Minus<T>>(op1, op2, index1, index2);
+        case '*': return new CalculusStep<T, Times<T>>(op1, op2, index1, index2);
+        case '/': return new CalculusStep<T, Divide<T>>(op1, op2, index1, index2);
+        case 'm': return new CalculusStep<T, Min<T>>(op1, op2, index1, index2);
+        case 'M': return new CalculusStep<T, Max<T>>(op1, op2, index1, index2);
+        default: throw runtime_error(string("Invalid operation: ") + operation);
+    }
+}
+
+// Tipul numeric și operația sunt legate aici, la încărcare; "float" este tipul flowurilor mai vechi
+Step* makeCalculusStep(string_view numericType, char operation, const Step* op1, const Step* op2, int index1, int index2) {
+    if (numericType.empty() || numericType == Numeric<float>::name) {
+        return makeCalculusStep<float>(operation, op1, op2, index1, index2);
+    } else if (numericType == Numeric<double>::name) {
+        return makeCalculusStep<double>(operation, op1, op2, index1, index2);
+    } else if (numericType == Numeric<int64_t>::name) {
+        return makeCalculusStep<int64_t>(operation, op1, op2, index1, index2);
+    } else if (numericType == Numeric<Decimal>::name) {
+        return makeCalculusStep<Decimal>(operation, op1, op2, index1, index2);
+    }
+    throw runtime_error("Unknown numeric type: " + string(numericType));
+}
+
+class DisplayStep : public Step {
+    string filename;
+
+    static string cacheKey(const filesystem::path& filePath) {
+        return "DisplayStep\n" + filePath.string() + "\n" + to_string(modificationTime(filePath));
+    }
+
+    static string readContent(const filesystem::path& filePath) {
+        TraceSpan span("io", "read");
+        span.setDetail(filePath.string());
+        ifstream file(filePath);
+        if (!file) {
+            throw runtime_error("Could not open file: " + filePath.filename().string());
+        }
+
+        string content, line;
+        while (getline(file, line)) {
+            content += line;
+            content += '\n';
+        }
+        return content;
+    }
+public:
+    DisplayStep(const string& filename) : filename(filename) {}
+    bool isDeterministic() const override { return true; }
+    StepTask execute() override {
+    const string directoryPath = "fisiere";
+    string name = filename + ".txt";
+    filesystem::path filePath = directoryPath + "/" + name;
+
+    // Verifies if the file exists
+    if (filesystem::exists(filePath)) {
+        // Conținutul e refolosit cât timp fișierul nu a fost modificat
+        string key, content;
+        if (cache) {
+            key = cacheKey(filePath);
+            if (cache->lookup("DisplayStep", key, content)) {
+                *out << content;
+                co_return;
+            }
+        }
+
+        content = readContent(filePath);
+        *out << content;
+        if (cache) {
+            cache->store(key, content);
+        }
+    } else {
+        throw runtime_error("File does not exist: " + name);
+    }
+    co_return;
+}
+    string_view typeName() const override { return "DisplayStep"; }
+    Step* clone(Step* const*) const override { return new DisplayStep(filename); }
+    string inputFile() const override {
+        return "fisiere/" + filename + ".txt";
+    }
+    // Cu memoizare, conținutul este citit direct în cache și pasul nu mai atinge discul
+    void prefetch() const override {
+        string filePath = inputFile();
+        if (!cache) {
+            adviseWillNeed(filePath);
+            return;
+        }
+        string key = cacheKey(filePath);
+        if (!cache->contains(key) && filesystem::exists(filePath)) {
+            cache->store(key, readContent(filePath), true);
+        }
+    }
+    void describe(TextSink& sink) const override {
+        sink << filename;
+    }
+    void writeInfo(TextSink& sink) const override {
+        sink << filename;
+    }
+};
+
+class TextFileInputStep : public Step {
+    string description;
+    string fileName;
+    string fileContent;
+public:
+    TextFileInputStep(const string& description) 
+        : description(description) {}
+    StepTask execute() override {
+        *out << "Enter the text file name: \n";
+        fileName = co_await in->readLine();
+
+        if(fileName.find(".txt") == std::string::npos)
+            fileName += ".txt";
+
+        TraceSpan span("io", "create");
+        span.setDetail(fileName);
+        ofstream file(outputPath(fileName));
+        if(file.is_open()){
+            *out << "File " << fileName << " is create \n";
+            *out << "Enter the content of the file. When finished, type 'STOP' \n";
+            while(true){
+                fileContent = co_await in->readLine();
+                if(fileContent == "STOP")
+                {
+                    *out << "End of story..";
+                    break;
+                }
+            file << fileContent << endl;
+            }
+            *out << "The content is written in file. \n";
+        }
+        else 
+            *out << "Error creating the file. \n";
+    }
+    void runBatch(BatchRun&, int) override {
+        throw runtime_error("TextFileInputStep is not supported in batch mode");
+    }
+    string getFileContent() const {
+        return fileContent;
+    }
+    string_view typeName() const override { return "TextFileInputStep"; }
+    Step* clone(Step* const*) const override { return new TextFileInputStep(description); }
+    void describe(TextSink& sink) const override {
+        sink << description;
+    }
+    void writeInfo(TextSink& sink) const override {
+        sink << fileContent;
+    }
+    // Fișierul scris rămâne pe disc; se refac doar numele și ultima linie citită
+    void saveState(StateWriter& state) const override {
+        state.writeString(fileName);
+        state.writeString(fileContent);
+    }
+    void restoreState(StateReader& state) override {
+        fileName = state.readString();
+        fileContent = state.readString();
+    }
+    
+};
+
+class CSVFileInputStep : public Step {
+    string description;
+    string fileName;
+    string fileContent;
+
+public:
+    CSVFileInputStep(const string& description) 
+        : description(description) {}
+
+    StepTask execute() override {
+        *out << "Enter the csv file name: \n";
+        fileName = co_await in->readLine();
+
+        if (fileName.find(".csv") == string::npos)
+            fileName += ".csv";
+
+        TraceSpan span("io", "create");
+        span.setDetail(fileName);
+        ofstream file(outputPath(fileName).c_str());
+
+        if (!file.is_open())
+            *out << "The file is not open. \n";
+
+        int rows = 0, cols = 0; 
+        *out << "Enter the number of rows: \n";
+        istringstream(co_await in->readLine()) >> rows;
+        *out << "Enter the number of cols: \n";
+        istringstream(co_await in->readLine()) >> cols;
+
+        for (int i = 0; i < rows; ++i) {
+            for (int j = 0; j < cols; ++j){
+                double value = 0;
+                *out << "Enter value in file or 'q' to exit : \n";
+                string input = co_await in->readLine();
+
+                if (input == "q") {
+                    *out << "Exit \n\n";
+                    file.close(); 
+                    co_return;
+                }
+
+                istringstream iss(input);
+                iss >> value;
+
+                file << value;
+
+                if (j < cols - 1)
+                    file << ",";
+            }
+            file << " ";
+            file << endl;
+        }
+
+        *out << "The CSV file is created: " << fileName << '\n';
+        file.close();
+    }
+
+    void runBatch(BatchRun&, int) override {
+        throw runtime_error("CSVFileInputStep is not supported in batch mode");
+    }
+
+    string getFileContent() const {
+        return fileContent;
+    }
+
+    string_view typeName() const override { return "CSVFileInputStep"; }
+    Step* clone(Step* const*) const override { return new CSVFileInputStep(description); }
+
+    void describe(TextSink& sink) const override {
+        sink << description;
+    }
+
+    void writeInfo(TextSink& sink) const override {
+        sink << fileContent;
+    }
+
+    void saveState(StateWriter& state) const override {
+        state.writeString(fileName);
+        state.writeString(fileContent);
+    }
+
+    void restoreState(StateReader& state) override {
+        fileName = state.readString();
+        fileContent = state.readString();
+    }
+};
+
+class OutputStep : public Step {
+private:
+    int step;
+    string fileName;
+    string title;
+    string description;
+    Step& previousStep;
+
+public:
+    OutputStep(int step, const string& fileName, const string& title, const string& description, Step& previousStep)
+        : step(step), fileName(fileName), title(title), description(description), previousStep(previousStep) {}
+
+    bool isDeterministic() const override { return true; }
+
+    StepTask execute() override {
+
+        if(fileName.find(".txt") == std::string::npos)
+            fileName += ".txt";
+
+        // Fișierul nu mai este rescris dacă are deja exact acest conținut, scris de noi
+        string key, writtenAt;
+        if (cache) {
+            key = "OutputStep\n" + fileName + "\n" + title + "\n" + description + "\n" +
+                  to_string(step) + "\n" + previousStep.getInfo();
+            if (cache->lookup("OutputStep", key, writtenAt) && writtenAt == to_string(modificationTime(outputPath(fileName)))) {
+                *out << "Open file for detail, file name: " << fileName << "\n";
+                co_return;
+            }
+        }
+
+        {
+            TraceSpan span("io", "write");
+            span.setDetail(fileName);
+            ofstream file(outputPath(fileName));
+            if (!file.is_open()) {
+                throw runtime_error("Could not open file: " + fileName);}
+            
+            file << "File Name: " << fileName << '\n';
+            file << "Title: " << title << '\n';
+            file << "Description: " << description << '\n';
+            file << "Information from step " << step << ": " << previousStep.getInfo() << '\n';
+        }
+        if (cache) {
+            cache->store(key, to_string(modificationTime(outputPath(fileName))));
+        }
+
+        *out << "Open file for detail, file name: " << fileName << "\n";
+        co_return;
+    }
+
+    // Un singur fișier pentru toate rândurile, scris dintr-o dată
+    void runBatch(BatchRun& batch, int) override {
+        if(fileName.find(".txt") == std::string::npos)
+            fileName += ".txt";
+
+        const vector<string>& values = batch.text(&previousStep);
+        string content = "File Name: " + fileName + "\nTitle: " + title + "\nDescription: " + description + "\n";
+        string prefix = "Information from step " + to_string(step) + ", row ";
+        for (size_t r = 0; r < batch.rows; r++) {
+            content += prefix;
+            content += to_string(r + 1);
+            content += ": ";
+            content += r < values.size() ? values[r] : previousStep.getInfo();
+            content += '\n';
+        }
+
+        TraceSpan span("io", "write");
+        span.setDetail(fileName);
+        ofstream file(outputPath(fileName), ios::binary);
+        if (!file.is_open()) {
+            throw runtime_error("Could not open file: " + fileName);
+        }
+        file.write(content.data(), content.size());
+        *out << "Open file for detail, file name: " << fileName << "\n";
+    }
+
+    string_view typeName() const override { return "OutputStep"; }
+    Step* clone(Step* const* steps) const override {
+        return new OutputStep(step, fileName, title, description, *steps[step - 1]);
+    }
+    void describe(TextSink& sink) const override {
+        sink << step << '\n' << fileName << '\n' << title << '\n' << description << '\n';
+        previousStep.writeInfo(sink);
+    }
+    void describeDefinition(TextSink& sink) const override {
+        sink << step << '\n' << fileName << '\n' << title << '\n' << description << '\n';
+    }
+    // execute() completează extensia numelui de fișier
+    void saveState(StateWriter& state) const override {
+        state.writeString(fileName);
+    }
+    void restoreState(StateReader& state) override {
+        fileName = state.readString();
+    }
+};
+
+class EndStep : public Step {
+public:
+    StepTask execute() override {
+        *out << "End of flow.\n";
+        co_return;
+    }
+    string_view typeName() const override { return "EndStep"; }
+    Step* clone(Step* const*) const override { return new EndStep(); }
+    void describe(TextSink& sink) const override {
+        sink << "End step";
+    }
+};
+
+#ifndef _WIN32
+// Contoarele unui flow într-un segment POSIX de memorie partajată ("/proba-analytics-2-<flow>"),
+// actualizate fără lock-uri de toate procesele care rulează flowul. Fiecare contor are linia
+// lui de cache, ca procesele să nu își invalideze reciproc contoarele.
+// Contoarele pasului i sunt mereu la aceeași poziție, indiferent câți pași are flowul în fiecare
+// proces; segmentul doar crește, iar o mapare mai mare se adaugă lângă cele vechi, care rămân
+// valide cât timp există obiectul (flowurile din alte fire pot folosi încă una veche).
+class SharedAnalytics {
+    struct alignas(64) Counter {
+        atomic<long long> value;
+    };
+    struct Header {
+        atomic<int> stepCount; // cel mai mare număr de pași văzut de vreun proces
+        Counter started;
+        Counter completed;
+    };
+    struct StepCounters {
+        Counter skips;
+        Counter errors;
+    };
+    struct Mapping {
+        void* memory;
+        size_t size;
+        StepCounters* steps;
+        int stepCount;
+    };
+    static_assert(atomic<long long>::is_always_lock_free, "shared counters must be lock-free");
+
+    string segmentName;
+    Header* header = nullptr;
+    deque<Mapping> mappings; // toate păstrate până la distrugere; deque nu mută elementele
+    atomic<const Mapping*> current{nullptr};
+    mutex growMutex;
+
+    static string nameFor(const string& flowName) {
+        // "-2-": segmentele scrise cu așezarea veche (toate skip-urile, apoi toate erorile) nu sunt refolosite
+        string name = "/proba-analytics-2-" + flowName;
+        replace(name.begin() + 1, name.end(), '/', '_');
+        return name;
+    }
+
+    static size_t segmentSize(int steps) {
+        return sizeof(Header) + steps * sizeof(StepCounters);
+    }
+
+    // Mărește segmentul la cel puțin "steps" pași și îl mapează în întregime.
+    // Un segment nou sau mărit este umplut cu zero, adică toate contoarele pornesc de la 0.
+    Mapping mapSegment(int steps) {
+        int fd = shm_open(segmentName.c_str(), O_RDWR | O_CREAT, 0660);
+        if (fd < 0) {
+            throw runtime_error("Could not open shared analytics " + segmentName);
+        }
+        // Lock-ul oprește două procese să mărească segmentul simultan, ca niciunul să nu îl micșoreze
+        flock(fd, LOCK_EX);
+        struct stat info;
+        size_t size = segmentSize(steps);
+        bool sized = fstat(fd, &info) == 0;
+        if (sized && static_cast<size_t>(info.st_size) < size) {
+            sized = ftruncate(fd, size) == 0;
+        } else if (sized) {
+            size = info.st_size;
+        }
+        flock(fd, LOCK_UN);
+        void* memory = sized ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        close(fd);
+        if (!sized) {
+            throw runtime_error("Could not size shared analytics " + segmentName);
+        }
+        if (memory == MAP_FAILED) {
+            throw runtime_error("Could not map shared analytics " + segmentName);
+        }
+        int mapped = (size - sizeof(Header)) / sizeof(StepCounters);
+        return Mapping{memory, size, reinterpret_cast<StepCounters*>(static_cast<Header*>(memory) + 1), mapped};
+    }
+
+    SharedAnalytics(const string& flowName, int maxSteps) : segmentName(nameFor(flowName)) {
+        mappings.push_back(mapSegment(maxSteps));
+        header = static_cast<Header*>(mappings.back().memory);
+        current.store(&mappings.back(), memory_order_release);
+        reserve(maxSteps);
+    }
+
+    // Adaugă o mapare care acoperă cel puțin "steps" pași, dacă cea curentă nu ajunge
+    void reserve(int steps) {
+        lock_guard<mutex> lock(growMutex);
+        int known = header->stepCount.load();
+        while (known < steps && !header->stepCount.compare_exchange_weak(known, steps)) {
+        }
+        if (current.load(memory_order_acquire)->stepCount >= steps) {
+            return;
+        }
+        mappings.push_back(mapSegment(steps));
+        current.store(&mappings.back(), memory_order_release);
+    }
+
+    static mutex segmentsMutex;
+    static map<string, unique_ptr<SharedAnalytics>> segments;
+    // Segmentele flowurilor șterse, încă folosite poate de flowuri care rulează
+    static vector<unique_ptr<SharedAnalytics>> retired;
+
+public:
+    SharedAnalytics(const SharedAnalytics&) = delete;
+    SharedAnalytics& operator=(const SharedAnalytics&) = delete;
+    ~SharedAnalytics() {
+        for (const Mapping& mapping : mappings) {
+            munmap(mapping.memory, mapping.size);
+        }
+    }
+
+    // Un singur obiect per flow și proces, păstrat până la ieșire; un flow mai mare doar îl mărește
+    static SharedAnalytics* open(const string& flowName, int maxSteps) {
+        lock_guard<mutex> lock(segmentsMutex);
+        unique_ptr<SharedAnalytics>& segment = segments[flowName];
+        if (!segment) {
+            segment.reset(new SharedAnalytics(flowName, maxSteps));
+        } else {
+            segment->reserve(maxSteps);
+        }
+        return segment.get();
+    }
+
+    // Apelat la ștergerea flowului: un flow nou cu același nume pornește de la zero
+    static void remove(const string& flowName) {
+        lock_guard<mutex> lock(segmentsMutex);
+        auto it = segments.find(flowName);
+        if (it != segments.end()) {
+            retired.push_back(move(it->second));
+            segments.erase(it);
+        }
+        shm_unlink(nameFor(flowName).c_str());
+    }
+
+    void start() { header->started.value.fetch_add(1, memory_order_relaxed); }
+    void complete() { header->completed.value.fetch_add(1, memory_order_release); }
+    void skip(int stepIndex) {
+        const Mapping* mapping = current.load(memory_order_acquire);
+        if (stepIndex < mapping->stepCount) mapping->steps[stepIndex].skips.value.fetch_add(1, memory_order_relaxed);
+    }
+    void error(int stepIndex) {
+        const Mapping* mapping = current.load(memory_order_acquire);
+        if (stepIndex < mapping->stepCount) mapping->steps[stepIndex].errors.value.fetch_add(1, memory_order_relaxed);
+    }
+
+    // Totalul live al tuturor proceselor, pentru toți pașii văzuți de oricare dintre ele;
+    // "completed" este citit primul, deci nu depășește "started"
+    void print(ostream& out = cout) {
+        reserve(header->stepCount.load());
+        const Mapping* mapping = current.load(memory_order_acquire);
+        int steps = min(header->stepCount.load(), mapping->stepCount);
+        long long completed = header->completed.value.load(memory_order_acquire);
+        long long started = header->started.value.load(memory_order_acquire);
+        out << "Times started: " << started << '\n';
+        out << "Times completed: " << completed << '\n';
+        out << "Skip counts:\n";
+        for (int i = 0; i < steps; i++) {
+            out << "  Step " << (i + 1) << ": " << mapping->steps[i].skips.value.load(memory_order_relaxed) << '\n';
+        }
+        out << "Error counts:\n";
+        for (int i = 0; i < steps; i++) {
+            out << "  Step " << (i + 1) << ": " << mapping->steps[i].errors.value.load(memory_order_relaxed) << '\n';
+        }
+    }
+};
+
+mutex SharedAnalytics::segmentsMutex;
+map<string, unique_ptr<SharedAnalytics>> SharedAnalytics::segments;
+vector<unique_ptr<SharedAnalytics>> SharedAnalytics::retired;
+#endif
+
+// Evenimentele de analytics ale tuturor rulărilor din proces. Fiecare fir scrie într-un
+// ring buffer propriu (un singur producător, un singur consumator), fără lock-uri; un fir
+// de fundal golește ringurile în contoare și histograme. Firul pornește la prima rulare a unui
+// flow; cât timp vin evenimente golește la fiecare milisecundă, iar fără ele așteaptă tot mai
+// mult, până la o secundă. Un ring pe jumătate plin îl trezește imediat.
+// Dacă un ring este plin, evenimentul este aruncat și numărat.
+class AnalyticsPipeline {
+public:
+    enum EventType : uint8_t { Start, Complete, Skip, Error };
+
+private:
+    struct Event {
+        uint32_t flowId;
+        int32_t stepIndex;
+        uint64_t durationNs;
+        EventType type;
+    };
+
+    struct Ring {
+        static constexpr size_t capacity = 4096;
+        Event events[capacity];
+        alignas(64) atomic<size_t> head{0};
+        alignas(64) atomic<size_t> tail{0};
+        atomic<long long> dropped{0};
+        atomic<bool> retired{false};
+    };
+
+    // La ieșirea firului, ringul lui este eliberat de agregator după ce a fost golit
+    struct ThreadRing {
+        Ring* ring = nullptr;
+        ~ThreadRing() {
+            if (ring) ring->retired.store(true, memory_order_release);
+        }
+    };
+
+    static constexpr int histogramBuckets = 40;
+    struct Totals {
+        string name;
+        long long started = 0;
+        long long completed = 0;
+        vector<long long> skips;
+        vector<long long> errors;
+        long long stepTime[histogramBuckets] = {};
+    };
+
+    mutex ringsMutex;
+    vector<Ring*> rings;
+    mutable mutex totalsMutex;
+    vector<Totals> totals;
+    map<string, uint32_t> flowIds;
+    long long dropped = 0;
+
+    mutex wakeMutex;
+    condition_variable wake;
+    condition_variable drained;
+    long long passes = 0;
+    bool stopping = false;
+    once_flag startOnce;
+    atomic<bool> running{false};
+    thread aggregator;
+
+    AnalyticsPipeline() = default;
+
+    Ring& threadRing() {
+        thread_local ThreadRing local;
+        if (local.ring == nullptr) {
+            local.ring = new Ring();
+            lock_guard<mutex> lock(ringsMutex);
+            rings.push_back(local.ring);
+        }
+        return *local.ring;
+    }
+
+    void apply(const Event& event) {
+        Totals& flow = totals[event.flowId];
+        switch (event.type) {
+            case Start:
+                flow.started++;
+                break;
+            case Complete: {
+                flow.completed++;
+                int bucket = event.durationNs == 0 ? 0 : 64 - __builtin_clzll(event.durationNs);
+                flow.stepTime[min(bucket, histogramBuckets - 1)]++;
+                break;
+            }
+            case Skip:
+                if (event.stepIndex < static_cast<int>(flow.skips.size())) flow.skips[event.stepIndex]++;
+                break;
+            case Error:
+                if (event.stepIndex < static_cast<int>(flow.errors.size())) flow.errors[event.stepIndex]++;
+                break;
+        }
+    }
+
+    // Întoarce true dacă a găsit evenimente
+    bool drainAll() {
+        lock_guard<mutex> ringsLock(ringsMutex);
+        lock_guard<mutex> totalsLock(totalsMutex);
+        bool found = false;
+        for (size_t i = 0; i < rings.size();) {
+            Ring* ring = rings[i];
+            bool retired = ring->retired.load(memory_order_acquire);
+            size_t tail = ring->tail.load(memory_order_relaxed);
+            size_t head = ring->head.load(memory_order_acquire);
+            found = found || tail != head;
+            for (; tail != head; tail++) {
+                apply(ring->events[tail % Ring::capacity]);
+            }
+            ring->tail.store(tail, memory_order_release);
+            dropped += ring->dropped.exchange(0, memory_order_relaxed);
+
+            if (retired) {
+                delete ring;
+                rings[i] = rings.back();
+                rings.pop_back();
+            } else {
+                i++;
+            }
+        }
+        return found;
+    }
+
+    void aggregate() {
+        unique_lock<mutex> lock(wakeMutex);
+        chrono::milliseconds idle(1);
+        while (true) {
+            wake.wait_for(lock, idle);
+            bool last = stopping;
+            lock.unlock();
+            bool busy = drainAll();
+            lock.lock();
+            passes++;
+            drained.notify_all();
+            if (last) {
+                return;
+            }
+            idle = busy ? chrono::milliseconds(1) : min(idle * 2, chrono::milliseconds(1000));
+        }
+    }
+
+public:
+    static AnalyticsPipeline& instance() {
+        static AnalyticsPipeline pipeline;
+        return pipeline;
+    }
+
+    ~AnalyticsPipeline() {
+        {
+            lock_guard<mutex> lock(wakeMutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        if (aggregator.joinable()) {
+            aggregator.join();
+        }
+        for (Ring* ring : rings) {
+            delete ring;
+        }
+    }
+
+    // Pornește firul agregator; apelat când un flow începe să ruleze, nu la încărcare
+    void ensureRunning() {
+        call_once(startOnce, [this] {
+            aggregator = thread(&AnalyticsPipeline::aggregate, this);
+            running.store(true, memory_order_release);
+        });
+    }
+
+    // Se apelează o dată pentru fiecare flow încărcat, nu pe drumul critic
+    uint32_t registerFlow(const string& name, int steps) {
+        lock_guard<mutex> lock(totalsMutex);
+        auto it = flowIds.find(name);
+        if (it != flowIds.end()) {
+            Totals& flow = totals[it->second];
+            if (static_cast<int>(flow.skips.size()) < steps) {
+                flow.skips.resize(steps);
+                flow.errors.resize(steps);
+            }
+            return it->second;
+        }
+        uint32_t id = totals.size();
+        totals.emplace_back();
+        totals.back().name = name;
+        totals.back().skips.resize(steps);
+        totals.back().errors.resize(steps);
+        flowIds[name] = id;
+        return id;
+    }
+
+    // Drumul critic: câteva load/store atomice în ringul firului curent
+    void record(uint32_t flowId, EventType type, int stepIndex = 0, uint64_t durationNs = 0) noexcept {
+        Ring& ring = threadRing();
+        size_t head = ring.head.load(memory_order_relaxed);
+        if (head - ring.tail.load(memory_order_acquire) == Ring::capacity) {
+            ring.dropped.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+        ring.events[head % Ring::capacity] = Event{flowId, stepIndex, durationNs, type};
+        ring.head.store(head + 1, memory_order_release);
+        if (head - ring.tail.load(memory_order_relaxed) == Ring::capacity / 2) {
+            wake.notify_one(); // Agregatorul poate dormi până la o secundă
+        }
+    }
+
+    // Așteaptă ca toate evenimentele înregistrate înainte de apel să ajungă în totaluri
+    void sync() {
+        if (!running.load(memory_order_acquire)) {
+            drainAll(); // Niciun flow nu a rulat încă, nu există fir agregator
+            return;
+        }
+        unique_lock<mutex> lock(wakeMutex);
+        long long target = passes + 2;
+        wake.notify_one();
+        drained.wait(lock, [&] { return passes >= target || stopping; });
+    }
+
+    bool print(const string& flowName, ostream& out = cout) {
+        sync();
+        lock_guard<mutex> lock(totalsMutex);
+        auto it = flowIds.find(flowName);
+        if (it == flowIds.end()) {
+            return false;
+        }
+        const Totals& flow = totals[it->second];
+        out << "Times started: " << flow.started << '\n';
+        out << "Times completed: " << flow.completed << '\n';
+        out << "Skip counts:\n";
+        for (size_t i = 0; i < flow.skips.size(); i++) {
+            out << "  Step " << (i + 1) << ": " << flow.skips[i] << '\n';
+        }
+        out << "Error counts:\n";
+        for (size_t i = 0; i < flow.errors.size(); i++) {
+            out << "  Step " << (i + 1) << ": " << flow.errors[i] << '\n';
+        }
+        out << "Step time histogram:\n";
+        for (int b = 0; b < histogramBuckets; b++) {
+            if (flow.stepTime[b] && b == 0) {
+                out << "  not executed: " << flow.stepTime[b] << '\n';
+            } else if (flow.stepTime[b]) {
+                out << "  < " << (1ULL << b) << " ns: " << flow.stepTime[b] << '\n';
+            }
+        }
+        if (dropped) {
+            out << "Dropped events: " << dropped << '\n';
+        }
+        return true;
+    }
+};
+
+class Analytics {
+    uint32_t flowId;
+    int timesStarted = 0;
+    int timesCompleted = 0;
+    int* skipCounts;
+    int* errorCounts;
+    int skipCountsSize;
+#ifndef _WIN32
+    SharedAnalytics* shared = nullptr;
+#endif
+public:
+    Analytics(const string& flowName, int maxSteps)
+        : flowId(AnalyticsPipeline::instance().registerFlow(flowName, maxSteps)), skipCountsSize(maxSteps) {
+        skipCounts = new int[skipCountsSize]();
+        errorCounts = new int[skipCountsSize]();
+    }
+    ~Analytics() {
+        delete[] skipCounts;
+        delete[] errorCounts;
+    }
+    // Contoarele acestei rulări sunt locale; totalul procesului trece prin AnalyticsPipeline,
+    // iar cel al tuturor proceselor prin segmentul partajat
+#ifndef _WIN32
+    void share(SharedAnalytics* segment) { shared = segment; }
+    void start() { timesStarted++; AnalyticsPipeline::instance().ensureRunning(); record(AnalyticsPipeline::Start); if (shared) shared->start(); }
+    void complete(uint64_t durationNs = 0) { timesCompleted++; record(AnalyticsPipeline::Complete, 0, durationNs); if (shared) shared->complete(); }
+    void skip(int stepIndex) { skipCounts[stepIndex]++; record(AnalyticsPipeline::Skip, stepIndex); if (shared) shared->skip(stepIndex); }
+    void error(int stepIndex) { errorCounts[stepIndex]++; record(AnalyticsPipeline::Error, stepIndex); if (shared) shared->error(stepIndex); } 
+#else
+    void start() { timesStarted++; AnalyticsPipeline::instance().ensureRunning(); record(AnalyticsPipeline::Start); }
+    void complete(uint64_t durationNs = 0) { timesCompleted++; record(AnalyticsPipeline::Complete, 0, durationNs); }
+    void skip(int stepIndex) { skipCounts[stepIndex]++; record(AnalyticsPipeline::Skip, stepIndex); }
+    void error(int stepIndex) { errorCounts[stepIndex]++; record(AnalyticsPipeline::Error, stepIndex); } 
+#endif
+    void record(AnalyticsPipeline::EventType type, int stepIndex = 0, uint64_t durationNs = 0) {
+        AnalyticsPipeline::instance().record(flowId, type, stepIndex, durationNs);
+    }
+    void print(ostream& out = cout) const {
+        out << "Times started: " << timesStarted << '\n';
+        out << "Times completed: " << timesCompleted << '\n';
+        out << "Skip counts:\n";
+        for (int i = 0; i < skipCountsSize; i++) {
+            out << "  Step " << (i + 1) << ": " << skipCounts[i] << '\n';
+        }
+        out << "Error counts:\n";
+        for (int i = 0; i < skipCountsSize; i++) {
+            out << "  Step " << (i + 1) << ": " << errorCounts[i] << '\n';
+        }
+    }
+
+};
+
+class Checkpoint;
+
+// Firul de I/O al procesului care aduce în avans fișierele pașilor următori, cât timp rulările
+// așteaptă răspunsul utilizatorului. Un singur fir pentru toate flowurile și sesiunile, pornit la
+// prima cerere. Erorile sunt ignorate aici; pasul le raportează când rulează.
+class Prefetcher {
+    struct Job {
+        const void* owner; // flowul căruia îi aparține pasul
+        const Step* step;
+    };
+    deque<Job> pending;
+    const void* active = nullptr; // flowul al cărui pas este în lucru
+    mutex m;
+    condition_variable ready;
+    condition_variable finished;
+    bool stopping = false;
+    thread worker;
+
+    Prefetcher() = default;
+
+    void loop() {
+        unique_lock<mutex> lock(m);
+        while (true) {
+            ready.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (stopping) {
+                return;
+            }
+            Job job = pending.front();
+            pending.pop_front();
+            active = job.owner;
+            lock.unlock();
+            try {
+                TraceSpan span("io", "prefetch");
+                span.setDetail(job.step->inputFile());
+                job.step->prefetch();
+            } catch (const exception&) {
+            }
+            lock.lock();
+            active = nullptr;
+            finished.notify_all();
+        }
+    }
+
+public:
+    static inline atomic<bool> enabled{true};
+
+    static Prefetcher& instance() {
+        static Prefetcher prefetcher;
+        return prefetcher;
+    }
+
+    // Pașii încă neatinși sunt abandonați; cel în lucru este terminat
+    ~Prefetcher() {
+        {
+            lock_guard<mutex> lock(m);
+            stopping = true;
+            pending.clear();
+        }
+        ready.notify_one();
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    void schedule(const void* owner, const Step* step) {
+        bool wasEmpty;
+        {
+            lock_guard<mutex> lock(m);
+            if (!worker.joinable()) {
+                worker = thread(&Prefetcher::loop, this);
+            }
+            wasEmpty = pending.empty();
+            pending.push_back({owner, step});
+        }
+        // Firul este treaz cât timp coada nu e goală
+        if (wasEmpty) {
+            ready.notify_one();
+        }
+    }
+
+    // Apelat înainte ca flowul să își șteargă pașii: scoate cererile lui din coadă și
+    // așteaptă pasul lui aflat în lucru
+    void cancel(const void* owner) {
+        unique_lock<mutex> lock(m);
+        erase_if(pending, [owner](const Job& job) { return job.owner == owner; });
+        finished.wait(lock, [this, owner] { return active != owner; });
+    }
+};
+
+class Flow {
+private:
+    Step** steps;
+    int stepCount;
+    int stepCapacity;
+    string name;
+    time_t timestamp;
+    Analytics analytics;
+    InputSource* in = &ConsoleInput::instance();
+    OutputSink* out = &TerminalSink::instance();
+    string outputDirectory;
+    Checkpoint* checkpoint = nullptr;
+    int prefetched = 0; // pașii de dinainte au fost deja trimiși la prefetch
+    bool prefetching = false; // Prefetcher are sau a avut cereri pentru pașii acestui flow
+    static constexpr int prefetchDistance = 4;
+
+    // Trimite la prefetch pașii cu fișiere, de la stepIndex până la prefetchDistance pași înainte
+    void prefetchFrom(int stepIndex) {
+        if (!Prefetcher::enabled) {
+            return;
+        }
+        int last = min(stepCount, stepIndex + 1 + prefetchDistance);
+        for (prefetched = max(prefetched, stepIndex); prefetched < last; prefetched++) {
+            if (steps[prefetched]->inputFile().empty()) {
+                continue;
+            }
+            Prefetcher::instance().schedule(this, steps[prefetched]);
+            prefetching = true;
+        }
+    }
+
+public:
+    Flow(const string& name, int maxSteps) : stepCount(0), stepCapacity(maxSteps), name(name), timestamp(time(nullptr)), analytics(name, maxSteps)  {
+        steps = new Step*[stepCapacity];
+    }
+
+    ~Flow() {
+        if (prefetching) {
+            Prefetcher::instance().cancel(this); // înainte de pași, firul de prefetch îi poate folosi
+        }
         for (int i = 0; i < stepCount; i++) {
             delete steps[i];
         }
-        delete[] steps;
+        delete[] steps;
+    }
+
+    int getStepCount() const {
+        return stepCount;
+    }
+
+    const string& getName() const {
+        return name;
+    }
+
+    // Momentul în care flowul a fost încărcat sau creat
+    time_t getTimestamp() const {
+        return timestamp;
+    }
+
+    int getMaxSteps() const {
+        return stepCapacity;
+    }
+
+    // Un flow nou cu aceiași pași, fără starea rulărilor acestuia și fără să recitească textul
+    Flow* clone() const {
+        Flow* copy = new Flow(name, stepCapacity);
+        try {
+            for (int i = 0; i < stepCount; i++) {
+                copy->addStep(steps[i]->clone(copy->steps));
+            }
+        } catch (...) {
+            delete copy;
+            throw;
+        }
+        return copy;
+    }
+
+    void addStep(Step* step) {
+        if (stepCount >= stepCapacity) {
+            throw runtime_error("Cannot add more steps: capacity reached");
+        }
+        step->in = in;
+        step->out = out;
+        step->outputDirectory = outputDirectory;
+        steps[stepCount++] = step;
+    }
+
+    // Activează memoizarea; pașii care citesc date de la utilizator nu primesc cache-ul
+    void setCache(StepCache* stepCache) {
+        for (int i = 0; i < stepCount; i++) {
+            steps[i]->cache = steps[i]->isDeterministic() ? stepCache : nullptr;
+        }
+    }
+
+    // Redirecționează întrebările și afișarea tuturor pașilor (ex. către o sesiune din daemon)
+    void setStreams(InputSource& input, OutputSink& output) {
+        in = &input;
+        out = &output;
+        for (int i = 0; i < stepCount; i++) {
+            steps[i]->in = in;
+            steps[i]->out = out;
+        }
+    }
+
+    // Fișierele scrise de pași ajung în acest director (ex. câte unul pentru fiecare job din replay)
+    void setOutputDirectory(const string& directory) {
+        outputDirectory = directory;
+        for (int i = 0; i < stepCount; i++) {
+            steps[i]->outputDirectory = directory;
+        }
+    }
+
+  StepTask run(Step& step, int stepIndex) {
+    chrono::steady_clock::time_point started{};
+    try {
+        analytics.start();
+        *out << "Do you want to skip this step? (Press 's' to skip, Enter to continue): ";
+        string choice = co_await in->readLine();
+
+        if (!choice.empty() && (choice[0] == 's' || choice[0] == 'S')) {
+            *out << "Step skipped ! " << '\n';
+            step.wasSkipped = true;
+            analytics.skip(stepIndex);
+            co_return;
+        } else if (choice.empty()) {
+            TraceSpan span("step", step.typeName(), stepIndex);
+            span.setDetail(name);
+            started = chrono::steady_clock::now();
+            co_await step.execute();
+        }
+    } catch (const std::exception& e) {
+        *out << "Error executing step: " << e.what() << '\n';
+        analytics.error(stepIndex);
+    }
+    uint64_t durationNs = started == chrono::steady_clock::time_point{} ? 0 :
+        chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count();
+    analytics.complete(durationNs);
+}
+
+    // Rulează flowul pe toate rândurile din batch, câte un pas (o coloană) o dată
+    void runBatch(BatchRun& batch) {
+        for (int i = 0; i < stepCount; i++) {
+            steps[i]->runBatch(batch, i);
+        }
+    }
+
+    // Rulează pașii în ordine, începând cu firstStep (0 la o rulare nouă)
+    StepTask runAll(int firstStep = 0);
+
+    // După fiecare pas terminat, starea lui este adăugată în checkpoint
+    void setCheckpoint(Checkpoint* runCheckpoint) {
+        checkpoint = runCheckpoint;
+    }
+    
+    
+    Step* getStep(int index) const {
+        if (index >= 0 && index < stepCount) {
+            return steps[index];
+        } else {
+            return nullptr;
+        }
+    }
+
+    void printSteps(ostream& output = cout) const {
+        StreamSink sink(output);
+        for (int i = 0; i < stepCount; i++) {
+            steps[i]->describe(sink);
+            sink << '\n';
+        }
+    }
+
+    void viewAnalytics(ostream& output = cout)
+    {
+        analytics.print(output);
+    }
+
+    const Analytics& getAnalytics() const {
+        return analytics;
+    }
+
+#ifndef _WIN32
+    // Contoarele rulărilor acestui flow sunt adunate și în segmentul partajat între procese
+    SharedAnalytics* shareAnalytics() {
+        SharedAnalytics* segment = SharedAnalytics::open(name, stepCapacity);
+        analytics.share(segment);
+        return segment;
+    }
+#endif
+
+};
+
+// Progresul unei rulări, salvat pe disc după fiecare pas: un antet (semnătură, versiune,
+// amprenta flowului) urmat de câte o înregistrare binară pentru fiecare pas terminat.
+// Dacă procesul se oprește, rularea poate fi reluată de la primul pas neterminat.
+class Checkpoint {
+    // FNV-1a peste tipul și definiția fiecărui pas: un checkpoint nu se aplică unui flow modificat
+    class HashSink : public TextSink {
+    public:
+        uint64_t hash = 1469598103934665603ULL;
+        void write(string_view text) override {
+            for (char c : text) {
+                hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+            }
+        }
+    };
+    struct Record {
+        bool skipped;
+        string state;
+    };
+    static constexpr uint32_t magic = 0x4b434250; // "PBCK"
+    static constexpr uint32_t version = 2;
+
+    string path;
+    uint64_t fingerprint = 0;
+    vector<Record> records;
+    ofstream file;
+    StateWriter record;
+#ifndef _WIN32
+    // Lock pe "<path>.lock", ținut cât trăiește obiectul: alt proces nu rulează același flow cu checkpoint
+    int lockFd = -1;
+#endif
+
+    static uint64_t fingerprintOf(const Flow& flow) {
+        HashSink sink;
+        sink << flow.getName() << '\n';
+        for (int i = 0; i < flow.getStepCount(); i++) {
+            const Step* step = flow.getStep(i);
+            sink << step->typeName() << '\n';
+            step->describeDefinition(sink);
+            sink << '\n';
+        }
+        return sink.hash;
+    }
+
+    // Rescrie fișierul cu înregistrările valide, apoi adaugă la final
+    void rewrite() {
+        file.close();
+        file.open(path, ios::binary | ios::trunc);
+        if (!file) {
+            throw runtime_error("Could not open checkpoint for writing: " + path);
+        }
+        StateWriter header;
+        header.writeInt(magic);
+        header.writeInt(version);
+        header.writeInt(static_cast<uint32_t>(fingerprint));
+        header.writeInt(static_cast<uint32_t>(fingerprint >> 32));
+        file.write(header.bytes().data(), header.bytes().size());
+        for (size_t i = 0; i < records.size(); i++) {
+            append(i, records[i]);
+        }
+        file.flush();
+    }
+
+    void append(uint32_t index, const Record& entry) {
+        record.clear();
+        record.writeInt(index);
+        record.writeInt(entry.skipped);
+        record.writeString(entry.state);
+        file.write(record.bytes().data(), record.bytes().size());
+    }
+
+public:
+    explicit Checkpoint(const string& path) : path(path) {}
+    Checkpoint(const Checkpoint&) = delete;
+    Checkpoint& operator=(const Checkpoint&) = delete;
+    ~Checkpoint() {
+#ifndef _WIN32
+        if (lockFd >= 0) {
+            ::close(lockFd);
+        }
+#endif
+    }
+
+    // Citește checkpoint-ul existent pentru flow; întoarce numărul de pași deja terminați.
+    // Un fișier lipsă, al altui flow sau trunchiat la final (oprire în timpul scrierii) dă
+    // doar înregistrările întregi. Aruncă excepție dacă alt proces folosește checkpoint-ul.
+    int open(const Flow& flow) {
+#ifndef _WIN32
+        if (lockFd < 0) {
+            string lockPath = path + ".lock";
+            int fd = ::open(lockPath.c_str(), O_RDWR | O_CREAT, 0644);
+            if (fd < 0) {
+                throw runtime_error("Could not open checkpoint lock: " + lockPath);
+            }
+            if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+                ::close(fd);
+                throw runtime_error("Another process is running this flow");
+            }
+            lockFd = fd;
+        }
+#endif
+        fingerprint = fingerprintOf(flow);
+        records.clear();
+
+        ifstream existing(path, ios::binary);
+        if (!existing) {
+            return 0;
+        }
+        ostringstream contents;
+        contents << existing.rdbuf();
+        string data = contents.str();
+        StateReader reader(data);
+        try {
+            if (reader.readInt() != magic || reader.readInt() != version) {
+                return 0;
+            }
+            uint64_t saved = reader.readInt();
+            saved |= static_cast<uint64_t>(reader.readInt()) << 32;
+            if (saved != fingerprint) {
+                return 0;
+            }
+            while (static_cast<int>(records.size()) < flow.getStepCount()) {
+                uint32_t index = reader.readInt();
+                bool skipped = reader.readInt() != 0;
+                string state = reader.readString();
+                if (index != records.size()) {
+                    break;
+                }
+                records.push_back({skipped, move(state)});
+            }
+        } catch (const runtime_error&) {
+            // Ultima înregistrare este incompletă
+        }
+        return records.size();
+    }
+
+    // Reface starea pașilor terminați și continuă checkpoint-ul de unde a rămas
+    int restore(Flow& flow) {
+        for (size_t i = 0; i < records.size(); i++) {
+            Step* step = flow.getStep(i);
+            step->wasSkipped = records[i].skipped;
+            StateReader state(records[i].state);
+            step->restoreState(state);
+        }
+        rewrite();
+        return records.size();
+    }
+
+    // Începe un checkpoint nou, ignorând progresul salvat
+    void reset() {
+        records.clear();
+        rewrite();
+    }
+
+    void save(int index, const Step& step) {
+        TraceSpan span("io", "checkpoint", index);
+        StateWriter state;
+        step.saveState(state);
+        Record entry{step.wasSkipped, state.bytes()};
+        append(index, entry);
+        file.flush();
+        records.push_back(move(entry));
+    }
+
+    // Flowul s-a terminat: nu mai este nimic de reluat
+    void complete() {
+        file.close();
+        error_code ec;
+        filesystem::remove(path, ec);
+        records.clear();
+    }
+};
+
+StepTask Flow::runAll(int firstStep) {
+    TraceSpan span("flow", "run");
+    if (Tracer::enabled.load(memory_order_relaxed)) {
+        // localtime nu poate fi folosit: rulările din replay sunt pe mai multe fire
+        tm local;
+#ifndef _WIN32
+        localtime_r(&timestamp, &local);
+#else
+        localtime_s(&local, &timestamp);
+#endif
+        char created[32];
+        strftime(created, sizeof(created), "%Y-%m-%d %H:%M:%S", &local);
+        span.setDetail(name + ", loaded " + created);
+    }
+    prefetched = firstStep;
+    for (int i = firstStep; i < stepCount; i++) {
+        // Fișierele pașilor următori sunt citite cât timp se așteaptă Enter
+        prefetchFrom(i);
+        *out << "Press Enter to execute Step " << i + 1 << "...";
+        co_await in->readLine();
+        co_await run(*steps[i], i);
+        if (checkpoint) {
+            checkpoint->save(i, *steps[i]);
+        }
+    }
+    if (checkpoint) {
+        checkpoint->complete();
+    }
+}
+
+// getline care acceptă și fișiere salvate cu terminații de linie Windows
+istream& readLine(istream& in, string& line) {
+    getline(in, line);
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+    return in;
+}
+
+// Citește un flow în formatul din "flows/*.txt" și validează fiecare pas
+Flow* loadFlow(istream& file) {
+    TraceSpan span("flow", "load");
+    string flowName;
+    int maxSteps;
+    if (!(file >> flowName >> maxSteps) || maxSteps < 0) {
+        throw runtime_error("Invalid flow header");
+    }
+    span.setDetail(flowName);
+    file.ignore(numeric_limits<streamsize>::max(), '\n'); // Consumă restul liniei
+
+    Flow* flow = new Flow(flowName, maxSteps);
+    try {
+        string stepType;
+        while (file >> stepType) {
+            file.ignore(numeric_limits<streamsize>::max(), '\n'); // Consumă restul liniei
+
+            if (stepType == "TitleStep") {
+                string title, subtitle;
+                readLine(file, title);
+                readLine(file, subtitle);
+                flow->addStep(new TitleStep(title, subtitle));
+
+            } else if (stepType == "TextStep") {
+                string title, copy;
+                readLine(file, title);
+                readLine(file, copy);
+                flow->addStep(new TextStep(title, copy));
+
+            } else if (stepType == "TextInputStep") {
+                string description;
+                readLine(file, description);
+                flow->addStep(new TextInputStep(description));
+
+            } else if (stepType == "NumberInputStep") {
+                string description;
+                readLine(file, description);
+                flow->addStep(new NumberInputStep(description));
+
+            } else if (stepType == "CalculusStep") {
+                // "<operație> <operand 1> <operand 2> [tip numeric]"
+                string line;
+                readLine(file, line);
+                istringstream iss(line);
+                char operation;
+                int operand1Index, operand2Index;
+                string numericType;
+                if (!(iss >> operation >> operand1Index >> operand2Index)) {
+                    throw runtime_error("Invalid CalculusStep");
+                }
+                iss >> numericType;
+
+                if (operand1Index < 1 || operand1Index > flow->getStepCount() ||
+                    operand2Index < 1 || operand2Index > flow->getStepCount()) {
+                    throw runtime_error("Invalid operand indices in CalculusStep");
+                }
+                Step* operand1 = flow->getStep(operand1Index - 1);
+                Step* operand2 = flow->getStep(operand2Index - 1);
+                flow->addStep(makeCalculusStep(numericType, operation, operand1, operand2, operand1Index, operand2Index));
+
+            } else if (stepType == "DisplayStep") {
+                string filename;
+                readLine(file, filename);
+                flow->addStep(new DisplayStep(filename));
+
+            } else if (stepType == "TextFileInputStep") {
+                string description;
+                readLine(file, description);
+                flow->addStep(new TextFileInputStep(description));
+
+            } else if (stepType == "CSVFileInputStep") {
+                string description;
+                readLine(file, description);
+                flow->addStep(new CSVFileInputStep(description));
+
+            } else if (stepType == "OutputStep") {
+                int s;
+                string filename, title, description;
+                if (!(file >> s)) {
+                    throw runtime_error("Invalid OutputStep");
+                }
+                file.ignore(numeric_limits<streamsize>::max(), '\n');
+                readLine(file, filename);
+                readLine(file, title);
+                readLine(file, description);
+                // saveFlowToFile scrie după descriere și informația pasului referit
+                string info;
+                readLine(file, info);
+
+                Step* previous = flow->getStep(s - 1);
+                if (previous == nullptr) {
+                    throw runtime_error("Invalid step index in OutputStep");
+                }
+                flow->addStep(new OutputStep(s, filename, title, description, *previous));
+
+            } else if (stepType == "EndStep") {
+                // Sărim peste descrierea "End step" salvată după etichetă
+                string description;
+                readLine(file, description);
+                flow->addStep(new EndStep());
+            } else {
+                throw runtime_error("Unknown step type: " + stepType);
+            }
+        }
+    } catch (...) {
+        delete flow;
+        throw;
+    }
+    return flow;
+}
+
+// Scrie flowul în formatul citit de loadFlow
+void saveFlow(ostream& file, const Flow& flow) {
+    file << flow.getName() << '\n';
+    file << flow.getMaxSteps() << '\n';
+
+    // Fiecare pas își scrie eticheta și detaliile direct în bufferul fișierului
+    StreamSink sink(file);
+    for (int i = 0; i < flow.getStepCount(); i++) {
+        const Step* step = flow.getStep(i);
+        sink << step->typeName() << '\n';
+        step->describe(sink);
+        sink << '\n';
+    }
+}
+
+// Compresie LZ77 pe blocuri, în stilul LZ4: secvențe de literali urmate de o copiere din
+// ultimii 64 KB. Fiecare secvență începe cu un octet: lungimea literalilor (4 biți de sus) și
+// lungimea copierii minus 4 (4 biți de jos); valorile de 15 continuă în octeți de câte 255.
+// Ultima secvență are doar literali.
+class BlockCodec {
+    static constexpr size_t minMatch = 4;
+    static constexpr size_t window = 65535;
+    static constexpr int hashBits = 14;
+
+    static uint32_t read32(const char* p) {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    static void writeLength(string& out, size_t length) {
+        while (length >= 255) {
+            out += static_cast<char>(255);
+            length -= 255;
+        }
+        out += static_cast<char>(length);
+    }
+    static void sequence(string& out, string_view literals, size_t offset, size_t matchLength) {
+        size_t matchCode = matchLength ? matchLength - minMatch : 0;
+        out += static_cast<char>((min<size_t>(literals.size(), 15) << 4) | min<size_t>(matchCode, 15));
+        if (literals.size() >= 15) {
+            writeLength(out, literals.size() - 15);
+        }
+        out.append(literals);
+        if (matchLength) {
+            out += static_cast<char>(offset & 0xff);
+            out += static_cast<char>(offset >> 8);
+            if (matchCode >= 15) {
+                writeLength(out, matchCode - 15);
+            }
+        }
+    }
+
+public:
+    static string compress(string_view input) {
+        string out;
+        out.reserve(input.size() / 2 + 16);
+        vector<uint32_t> table(1 << hashBits, 0); // poziția + 1 a ultimei apariții; 0 = niciuna
+        const char* data = input.data();
+        size_t size = input.size();
+        size_t anchor = 0;
+        size_t i = 0;
+        while (i + minMatch <= size) {
+            uint32_t sequenceStart = read32(data + i);
+            uint32_t hash = (sequenceStart * 2654435761u) >> (32 - hashBits);
+            size_t candidate = table[hash];
+            table[hash] = i + 1;
+            if (candidate == 0 || i - (candidate - 1) > window || read32(data + candidate - 1) != sequenceStart) {
+                i++;
+                continue;
+            }
+            candidate--;
+            size_t length = minMatch;
+            while (i + length < size && data[candidate + length] == data[i + length]) {
+                length++;
+            }
+            sequence(out, input.substr(anchor, i - anchor), i - candidate, length);
+            i += length;
+            anchor = i;
+        }
+        sequence(out, input.substr(anchor), 0, 0);
+        return out;
+    }
+
+    static string decompress(string_view input, size_t rawSize) {
+        string out;
+        out.reserve(rawSize);
+        size_t position = 0;
+        auto next = [&]() -> unsigned char {
+            if (position >= input.size()) {
+                throw runtime_error("Corrupt compressed block");
+            }
+            return input[position++];
+        };
+        auto readLength = [&](size_t length) {
+            if (length == 15) {
+                unsigned char more;
+                do {
+                    more = next();
+                    length += more;
+                } while (more == 255);
+            }
+            return length;
+        };
+        while (position < input.size()) {
+            unsigned char token = next();
+            size_t literals = readLength(token >> 4);
+            if (literals > input.size() - position || out.size() + literals > rawSize) {
+                throw runtime_error("Corrupt compressed block");
+            }
+            out.append(input.substr(position, literals));
+            position += literals;
+            if (position == input.size()) {
+                break;
+            }
+            size_t offset = next();
+            offset |= static_cast<size_t>(next()) << 8;
+            size_t length = readLength(token & 15) + minMatch;
+            if (offset == 0 || offset > out.size() || out.size() + length > rawSize) {
+                throw runtime_error("Corrupt compressed block");
+            }
+            // Copierea poate să se suprapună cu ce scrie (ex. un caracter repetat)
+            size_t from = out.size() - offset;
+            for (size_t k = 0; k < length; k++) {
+                out += out[from + k];
+            }
+        }
+        if (out.size() != rawSize) {
+            throw runtime_error("Corrupt compressed block");
+        }
+        return out;
+    }
+};
+
+// Mai multe flowuri într-un singur fișier, în loc de câte un fișier mic în "flows".
+// Structura: un antet (semnătură, versiune, poziția și mărimea indexului), blocurile cu sursele
+// flowurilor (comprimate cu BlockCodec dacă asta le micșorează), apoi indexul: nume, poziție,
+// mărimi, codec și o sumă de control pentru fiecare flow. Indexul este ținut în memorie într-un
+// unordered_map, deci găsirea unui flow costă o căutare și o singură citire de pe disc.
+// O scriere adaugă blocul și un index nou la final, apoi actualizează antetul; spațiul rămas
+// nefolosit este recuperat când depășește datele vii.
+class FlowPack {
+    struct Entry {
+        uint64_t offset;
+        uint32_t storedSize;
+        uint32_t rawSize;
+        uint32_t codec;
+        uint32_t checksum;
+    };
+    enum Codec : uint32_t { Stored, Lz };
+    static constexpr uint32_t magic = 0x4b504250; // "PBPK"
+    static constexpr uint32_t formatVersion = 1;
+    static constexpr uint64_t headerSize = 32;
+
+    string path;
+    unordered_map<string, Entry> entries;
+    uint64_t indexOffset = headerSize;
+    uint64_t indexSize = 0;
+    bool compression = true;
+    mutable mutex m;
+
+    static uint32_t checksumOf(string_view data) {
+        uint32_t hash = 2166136261u;
+        for (char c : data) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+        }
+        return hash;
+    }
+
+    void readIndex() {
+        ifstream file(path, ios::binary);
+        if (!file) {
+            throw runtime_error("Could not open pack: " + path);
+        }
+        string header(headerSize, '\0');
+        if (!file.read(header.data(), headerSize)) {
+            throw runtime_error("Invalid pack: " + path);
+        }
+        StateReader reader(header);
+        if (reader.readInt() != magic || reader.readInt() != formatVersion) {
+            throw runtime_error("Invalid pack: " + path);
+        }
+        indexOffset = reader.readLong();
+        indexSize = reader.readLong();
+        uint32_t count = reader.readInt();
+
+        string index(indexSize, '\0');
+        file.seekg(indexOffset);
+        if (!file.read(index.data(), indexSize)) {
+            throw runtime_error("Truncated pack index: " + path);
+        }
+        StateReader entriesReader(index);
+        entries.clear();
+        entries.reserve(count);
+        for (uint32_t i = 0; i < count; i++) {
+            string name = entriesReader.readString();
+            Entry entry;
+            entry.offset = entriesReader.readLong();
+            entry.storedSize = entriesReader.readInt();
+            entry.rawSize = entriesReader.readInt();
+            entry.codec = entriesReader.readInt();
+            entry.checksum = entriesReader.readInt();
+            entries[move(name)] = entry;
+        }
+    }
+
+    static string encodeIndex(const unordered_map<string, Entry>& entries) {
+        StateWriter index;
+        for (const auto& entry : entries) {
+            index.writeString(entry.first);
+            index.writeLong(entry.second.offset);
+            index.writeInt(entry.second.storedSize);
+            index.writeInt(entry.second.rawSize);
+            index.writeInt(entry.second.codec);
+            index.writeInt(entry.second.checksum);
+        }
+        return index.bytes();
+    }
+
+    static string encodeHeader(uint64_t indexOffset, uint64_t indexSize, size_t count) {
+        StateWriter header;
+        header.writeInt(magic);
+        header.writeInt(formatVersion);
+        header.writeLong(indexOffset);
+        header.writeLong(indexSize);
+        header.writeInt(count);
+        header.writeInt(0);
+        return header.bytes();
+    }
+
+    struct Block {
+        string name;
+        string data;
+        Entry entry;
+    };
+
+    Block encode(const string& name, const string& source) const {
+        Block block{name, {}, Entry{0, 0, static_cast<uint32_t>(source.size()), Stored, checksumOf(source)}};
+        if (compression) {
+            block.data = BlockCodec::compress(source);
+            block.entry.codec = Lz;
+        }
+        if (!compression || block.data.size() >= source.size()) {
+            block.data = source;
+            block.entry.codec = Stored;
+        }
+        block.entry.storedSize = block.data.size();
+        return block;
+    }
+
+    // Adaugă blocurile și un index nou la sfârșitul fișierului, apoi mută antetul pe el
+    void append(vector<Block>& blocks) {
+        fstream file(path, ios::binary | ios::in | ios::out);
+        if (!file) {
+            throw runtime_error("Could not open pack for writing: " + path);
+        }
+        uint64_t end = indexOffset + indexSize;
+        file.seekp(end);
+        for (Block& block : blocks) {
+            block.entry.offset = end;
+            file.write(block.data.data(), block.data.size());
+            end += block.data.size();
+            entries[block.name] = block.entry;
+        }
+        string index = encodeIndex(entries);
+        file.write(index.data(), index.size());
+        file.flush();
+        indexOffset = end;
+        indexSize = index.size();
+        string header = encodeHeader(indexOffset, indexSize, entries.size());
+        file.seekp(0);
+        file.write(header.data(), header.size());
+        if (!file.flush()) {
+            throw runtime_error("Could not write pack: " + path);
+        }
+    }
+
+    uint64_t liveBytes() const {
+        uint64_t live = 0;
+        for (const auto& entry : entries) {
+            live += entry.second.storedSize;
+        }
+        return live;
+    }
+
+    // Rescrie fișierul doar cu blocurile folosite; indexul din memorie se schimbă doar după
+    // ce noul fișier l-a înlocuit pe cel vechi
+    void compactIfWasteful() {
+        uint64_t live = liveBytes();
+        uint64_t wasted = indexOffset - headerSize - live;
+        if (wasted < 64 * 1024 || wasted < live) {
+            return;
+        }
+        string temporaryPath = path + ".tmp";
+        unordered_map<string, Entry> compacted;
+        compacted.reserve(entries.size());
+        uint64_t compactedIndexOffset;
+        uint64_t compactedIndexSize;
+        {
+            ifstream in(path, ios::binary);
+            ofstream out(temporaryPath, ios::binary | ios::trunc);
+            if (!in || !out) {
+                throw runtime_error("Could not compact pack: " + path);
+            }
+            out.write(string(headerSize, '\0').data(), headerSize);
+            uint64_t offset = headerSize;
+            string block;
+            for (const auto& entry : entries) {
+                block.resize(entry.second.storedSize);
+                in.seekg(entry.second.offset);
+                if (!in.read(block.data(), block.size())) {
+                    throw runtime_error("Could not compact pack: " + path);
+                }
+                out.write(block.data(), block.size());
+                Entry moved = entry.second;
+                moved.offset = offset;
+                compacted.emplace(entry.first, moved);
+                offset += block.size();
+            }
+            string index = encodeIndex(compacted);
+            out.write(index.data(), index.size());
+            compactedIndexOffset = offset;
+            compactedIndexSize = index.size();
+            string header = encodeHeader(compactedIndexOffset, compactedIndexSize, compacted.size());
+            out.seekp(0);
+            out.write(header.data(), header.size());
+            if (!out.flush()) {
+                throw runtime_error("Could not compact pack: " + path);
+            }
+        }
+        filesystem::rename(temporaryPath, path);
+        entries = move(compacted);
+        indexOffset = compactedIndexOffset;
+        indexSize = compactedIndexSize;
+    }
+
+public:
+    // Deschide arhiva sau o creează goală dacă nu există
+    explicit FlowPack(const string& path) : path(path) {
+        if (!filesystem::exists(path)) {
+            ofstream file(path, ios::binary);
+            string header = encodeHeader(indexOffset, indexSize, entries.size());
+            file.write(header.data(), header.size());
+            if (!file.flush()) {
+                throw runtime_error("Could not create pack: " + path);
+            }
+        }
+        readIndex();
+    }
+
+    const string& getPath() const {
+        return path;
+    }
+
+    void setCompression(bool enabled) {
+        compression = enabled;
+    }
+
+    vector<string> names() const {
+        lock_guard<mutex> lock(m);
+        vector<string> result;
+        for (const auto& entry : entries) {
+            result.push_back(entry.first);
+        }
+        sort(result.begin(), result.end());
+        return result;
+    }
+
+    bool contains(const string& name) const {
+        lock_guard<mutex> lock(m);
+        return entries.count(name) > 0;
+    }
+
+    // Versiunea curentă a sursei (poziția blocului), pentru indexul de căutare; -1 dacă lipsește
+    long long version(const string& name) const {
+        lock_guard<mutex> lock(m);
+        auto it = entries.find(name);
+        return it == entries.end() ? -1 : static_cast<long long>(it->second.offset);
+    }
+
+    map<string, long long> versions() const {
+        lock_guard<mutex> lock(m);
+        map<string, long long> result;
+        for (const auto& entry : entries) {
+            result[entry.first] = entry.second.offset;
+        }
+        return result;
+    }
+
+    // Sursa flowului, în formatul din "flows/*.txt"; false dacă nu este în arhivă
+    bool read(const string& name, string& source) const {
+        Entry entry;
+        {
+            lock_guard<mutex> lock(m);
+            auto it = entries.find(name);
+            if (it == entries.end()) {
+                return false;
+            }
+            entry = it->second;
+        }
+        ifstream file(path, ios::binary);
+        string block(entry.storedSize, '\0');
+        file.seekg(entry.offset);
+        if (!file.read(block.data(), block.size())) {
+            throw runtime_error("Could not read " + name + " from pack " + path);
+        }
+        source = entry.codec == Lz ? BlockCodec::decompress(block, entry.rawSize) : move(block);
+        if (checksumOf(source) != entry.checksum) {
+            throw runtime_error("Checksum mismatch for " + name + " in pack " + path);
+        }
+        return true;
+    }
+
+    void write(const string& name, const string& source) {
+        vector<Block> blocks{encode(name, source)};
+        lock_guard<mutex> lock(m);
+        append(blocks);
+        compactIfWasteful();
+    }
+
+    // Mai multe flowuri (nume, sursă) deodată, cu un singur index scris la final
+    void write(const vector<pair<string, string>>& flows) {
+        vector<Block> blocks;
+        blocks.reserve(flows.size());
+        for (const auto& flow : flows) {
+            blocks.push_back(encode(flow.first, flow.second));
+        }
+        lock_guard<mutex> lock(m);
+        append(blocks);
+        compactIfWasteful();
+    }
+
+    bool remove(const string& name) {
+        lock_guard<mutex> lock(m);
+        if (entries.erase(name) == 0) {
+            return false;
+        }
+        vector<Block> none;
+        append(none);
+        compactIfWasteful();
+        return true;
+    }
+
+    void printStats(ostream& out = cout) const {
+        lock_guard<mutex> lock(m);
+        uint64_t raw = 0;
+        for (const auto& entry : entries) {
+            raw += entry.second.rawSize;
+        }
+        out << entries.size() << " flows in " << path << ": " << raw << " bytes of source stored in "
+            << liveBytes() << " bytes, file size " << indexOffset + indexSize << " bytes\n";
+    }
+};
+
+// Păstrează în memorie toate flowurile din "flows", încărcate și validate o singură dată
+class FlowStore {
+    struct Entry {
+        Flow* flow = nullptr; // prototipul, niciodată rulat; sesiunile primesc copii
+    };
+    map<string, Entry> entries;
+
+public:
+    FlowStore() = default;
+    FlowStore(const FlowStore&) = delete;
+    FlowStore& operator=(const FlowStore&) = delete;
+
+    ~FlowStore() {
+        for (auto& entry : entries) {
+            delete entry.second.flow;
+        }
+    }
+
+    bool empty() const {
+        return entries.empty();
+    }
+
+    vector<string> names() const {
+        vector<string> result;
+        for (const auto& entry : entries) {
+            result.push_back(entry.first);
+        }
+        return result;
+    }
+
+    const Flow* find(const string& name) const {
+        auto it = entries.find(name);
+        return it != entries.end() ? it->second.flow : nullptr;
+    }
+
+    // Creează o copie a flowului pe care o poate rula o singură sesiune, fără acces la disc
+    // și fără să reinterpreteze sursa: pașii sunt copiați din flowul încărcat la warm-up
+    Flow* instantiate(const string& name) const {
+        auto it = entries.find(name);
+        if (it == entries.end()) {
+            return nullptr;
+        }
+        return it->second.flow->clone();
+    }
+
+    void remove(const string& name) {
+        auto it = entries.find(name);
+        if (it != entries.end()) {
+            delete it->second.flow;
+            entries.erase(it);
+        }
+    }
+
+    // Încarcă toate fișierele din director în paralel, pe toate nucleele
+    void warmUp(const string& directoryPath) {
+        vector<string> names;
+        for (const auto& entry : filesystem::directory_iterator(directoryPath)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".txt") {
+                names.push_back(entry.path().stem().string());
+            }
+        }
+        load(names, [&directoryPath](const string& name) {
+            ifstream file(directoryPath + "/" + name + ".txt", ios::binary);
+            if (!file) {
+                throw runtime_error("Could not open file");
+            }
+            ostringstream contents;
+            contents << file.rdbuf();
+            return contents.str();
+        });
+    }
+
+    // La fel, pentru flowurile dintr-o arhivă
+    void warmUp(const FlowPack& pack) {
+        load(pack.names(), [&pack](const string& name) {
+            string source;
+            if (!pack.read(name, source)) {
+                throw runtime_error("Not in pack");
+            }
+            return source;
+        });
+    }
+
+private:
+    void load(const vector<string>& names, const function<string(const string&)>& readSource) {
+        using Clock = chrono::steady_clock;
+        auto warmUpStart = Clock::now();
+
+        struct Result {
+            string name;
+            Flow* flow = nullptr;
+            string error;
+            double loadMs = 0;
+        };
+        vector<Result> results(names.size());
+        atomic<size_t> next(0);
+
+        auto worker = [&]() {
+            size_t i;
+            while ((i = next.fetch_add(1)) < names.size()) {
+                Result& result = results[i];
+                auto start = Clock::now();
+                result.name = names[i];
+                try {
+                    istringstream iss(readSource(names[i]));
+                    result.flow = loadFlow(iss);
+                } catch (const exception& e) {
+                    result.error = e.what();
+                }
+                result.loadMs = chrono::duration<double, milli>(Clock::now() - start).count();
+            }
+        };
+
+        size_t threadCount = max(1u, thread::hardware_concurrency());
+        threadCount = min(threadCount, max<size_t>(1, names.size()));
+        vector<thread> threads;
+        for (size_t t = 1; t < threadCount; t++) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        int loaded = 0;
+        for (auto& result : results) {
+            if (result.flow == nullptr) {
+                cout << "  " << result.name << ": FAILED (" << result.error << ")\n";
+                continue;
+            }
+            cout << "  " << result.name << ": " << result.loadMs << " ms\n";
+            remove(result.name);
+            entries[result.name] = Entry{result.flow};
+            loaded++;
+        }
+
+        double totalMs = chrono::duration<double, milli>(Clock::now() - warmUpStart).count();
+        cout << "Warm-up: " << loaded << "/" << results.size() << " flows loaded in "
+             << totalMs << " ms using " << threadCount << " threads\n";
+    }
+};
+
+// Împarte textul scris de un pas în cuvinte pentru index: litere și cifre, cu litere mici.
+// Octeții non-ASCII (ex. diacriticele în UTF-8) rămân în cuvânt.
+class TermSink : public TextSink {
+    vector<string>& terms;
+    string current;
+public:
+    explicit TermSink(vector<string>& terms) : terms(terms) {}
+    void write(string_view text) override {
+        for (char c : text) {
+            unsigned char u = static_cast<unsigned char>(c);
+            if (isalnum(u) || u >= 0x80) {
+                current += static_cast<char>(tolower(u));
+            } else {
+                finish();
+            }
+        }
+    }
+    void finish() {
+        if (!current.empty()) {
+            terms.push_back(move(current));
+            current.clear();
+        }
+    }
+};
+
+// Index invers peste toate flowurile din "flows": cuvânt -> flow -> indicii pașilor care îl conțin.
+// Sunt indexate tipul pasului, titlurile, textele, descrierile și numele fișierelor referite.
+// Indexul se păstrează pe disc lângă "flows" și se actualizează doar pentru flowurile salvate,
+// șterse sau modificate pe disc de la ultima deschidere.
+class FlowIndex {
+    struct Document {
+        uint32_t id = 0;
+        long long modified = -1;
+        vector<vector<string>> steps; // cuvintele fiecărui pas, sortate și unice
+    };
+    struct Posting {
+        uint32_t document;
+        uint32_t step;
+    };
+    string directoryPath;
+    string indexPath;
+    const FlowPack* pack = nullptr; // dacă este setat, flowurile sunt citite din arhivă, nu din director
+    map<string, Document> documents;
+    vector<string> names; // id -> numele flowului
+    vector<uint32_t> freeIds; // id-urile flowurilor uitate, refolosite de put
+    map<string, vector<Posting>> postings;
+    bool loaded = false;
+    bool dirty = false;
+
+    void forget(const string& name) {
+        auto it = documents.find(name);
+        if (it == documents.end()) {
+            return;
+        }
+        uint32_t id = it->second.id;
+        for (const auto& terms : it->second.steps) {
+            for (const string& term : terms) {
+                auto posting = postings.find(term);
+                if (posting == postings.end()) {
+                    continue;
+                }
+                erase_if(posting->second, [id](const Posting& p) { return p.document == id; });
+                if (posting->second.empty()) {
+                    postings.erase(posting);
+                }
+            }
+        }
+        names[id].clear();
+        freeIds.push_back(id);
+        documents.erase(it);
+        dirty = true;
+    }
+
+    void put(const string& name, Document document) {
+        forget(name);
+        if (freeIds.empty()) {
+            document.id = names.size();
+            names.push_back(name);
+        } else {
+            document.id = freeIds.back();
+            freeIds.pop_back();
+            names[document.id] = name;
+        }
+        for (size_t i = 0; i < document.steps.size(); i++) {
+            for (const string& term : document.steps[i]) {
+                postings[term].push_back({document.id, static_cast<uint32_t>(i)});
+            }
+        }
+        documents[name] = move(document);
+        dirty = true;
+    }
+
+    static Document index(const Flow& flow, long long modified) {
+        Document document;
+        document.modified = modified;
+        document.steps.resize(flow.getStepCount());
+        for (int i = 0; i < flow.getStepCount(); i++) {
+            const Step* step = flow.getStep(i);
+            vector<string>& terms = document.steps[i];
+            TermSink sink(terms);
+            sink << step->typeName() << '\n';
+            step->describe(sink);
+            sink.finish();
+            sort(terms.begin(), terms.end());
+            terms.erase(unique(terms.begin(), terms.end()), terms.end());
+        }
+        return document;
+    }
+
+    void read() {
+        ifstream file(indexPath, ios::binary);
+        if (!file) {
+            return; // Lipsă: indexul este reconstruit din flowuri
+        }
+        ostringstream contents;
+        contents << file.rdbuf();
+        string data = contents.str();
+        string_view text(data);
+
+        auto nextLine = [&text](string_view& line) {
+            if (text.empty()) {
+                return false;
+            }
+            size_t end = text.find('\n');
+            line = text.substr(0, end);
+            text.remove_prefix(end == string_view::npos ? text.size() : end + 1);
+            return true;
+        };
+
+        string_view line;
+        if (!nextLine(line) || line != "FLOWINDEX 1") {
+            return; // Alt format: indexul este reconstruit din flowuri
+        }
+        while (nextLine(line)) {
+            // <nume>\t<data modificării>\t<număr de pași>, apoi câte o linie de cuvinte pe pas
+            size_t first = line.find('\t');
+            size_t second = line.find('\t', first + 1);
+            Document document;
+            size_t steps = 0;
+            if (first == string_view::npos || second == string_view::npos ||
+                from_chars(line.data() + first + 1, line.data() + second, document.modified).ec != errc() ||
+                from_chars(line.data() + second + 1, line.data() + line.size(), steps).ec != errc()) {
+                break; // Restul fișierului este ignorat; flowurile lipsă sunt reindexate
+            }
+            string name(line.substr(0, first));
+            document.steps.resize(steps);
+            for (auto& terms : document.steps) {
+                if (!nextLine(line)) {
+                    break;
+                }
+                while (!line.empty()) {
+                    size_t space = line.find(' ');
+                    if (space != 0) {
+                        terms.emplace_back(line.substr(0, space));
+                    }
+                    line.remove_prefix(space == string_view::npos ? line.size() : space + 1);
+                }
+            }
+            put(name, move(document));
+        }
+        dirty = false;
+    }
+
+    // Reindexează doar fișierele noi sau modificate și uită flowurile care nu mai există
+    void refresh() {
+        map<string, long long> onDisk;
+        if (pack) {
+            onDisk = pack->versions();
+        } else {
+            error_code ec;
+            for (const auto& entry : filesystem::directory_iterator(directoryPath, ec)) {
+                if (entry.is_regular_file() && entry.path().extension() == ".txt") {
+                    onDisk[entry.path().stem().string()] = modificationTime(entry.path());
+                }
+            }
+        }
+
+        vector<string> gone;
+        for (const auto& entry : documents) {
+            if (onDisk.find(entry.first) == onDisk.end()) {
+                gone.push_back(entry.first);
+            }
+        }
+        for (const string& name : gone) {
+            forget(name);
+        }
+
+        for (const auto& entry : onDisk) {
+            auto it = documents.find(entry.first);
+            if (it != documents.end() && it->second.modified == entry.second) {
+                continue;
+            }
+            try {
+                string source;
+                if (pack) {
+                    pack->read(entry.first, source);
+                } else {
+                    ifstream file(directoryPath + "/" + entry.first + ".txt", ios::binary);
+                    ostringstream contents;
+                    contents << file.rdbuf();
+                    source = contents.str();
+                }
+                istringstream iss(source);
+                unique_ptr<Flow> flow(loadFlow(iss));
+                put(entry.first, index(*flow, entry.second));
+            } catch (const exception&) {
+                // Un flow invalid nu apare în rezultate, dar este reîncercat la următoarea modificare
+                put(entry.first, Document{0, entry.second, {}});
+            }
+        }
     }
 
-    int getStepCount() const {
-        return stepCount;
+public:
+    struct Match {
+        string flow;
+        vector<int> steps; // indici de la 1, ca în meniu
+    };
+
+    FlowIndex(const string& directoryPath, const string& indexPath)
+        : directoryPath(directoryPath), indexPath(indexPath) {}
+
+    // Indexează flowurile din arhivă în locul celor din director; indexul vechi este uitat
+    void usePack(const FlowPack* flowPack, const string& packIndexPath) {
+        pack = flowPack;
+        indexPath = packIndexPath;
+        documents.clear();
+        names.clear();
+        freeIds.clear();
+        postings.clear();
+        loaded = false;
+        dirty = false;
     }
 
-    string getName() const {
-        return name;
+    // Citește indexul de pe disc și îl aduce la zi; întoarce false dacă era deja deschis
+    bool ensureLoaded() {
+        if (loaded) {
+            return false;
+        }
+        loaded = true;
+        read();
+        refresh();
+        save();
+        return true;
     }
 
-    int getMaxSteps() const {
-        return stepCapacity;
+    // Apelat după ce flowul a fost scris în "flows/<nume>.txt" sau în arhivă
+    void update(const Flow& flow) {
+        ensureLoaded();
+        long long modified = pack ? pack->version(flow.getName())
+                                  : modificationTime(directoryPath + "/" + flow.getName() + ".txt");
+        put(flow.getName(), index(flow, modified));
+        save();
     }
 
-    void addStep(Step* step) {
-        if (stepCount >= stepCapacity) {
-            throw runtime_error("Cannot add more steps: capacity reached");
+    // Apelat după ce flowul a fost șters
+    void remove(const string& name) {
+        ensureLoaded();
+        forget(name);
+        save();
+    }
+
+    void save() {
+        if (!dirty) {
+            return;
         }
-        steps[stepCount++] = step;
+        // Scris într-un fișier temporar și redenumit, ca indexul de pe disc să fie mereu întreg
+        string temporaryPath = indexPath + ".tmp";
+        {
+            ofstream file(temporaryPath);
+            if (!file) {
+                throw runtime_error("Could not open file for writing: " + temporaryPath);
+            }
+            file << "FLOWINDEX 1\n";
+            for (const auto& entry : documents) {
+                file << entry.first << '\t' << entry.second.modified << '\t' << entry.second.steps.size() << '\n';
+                for (const auto& terms : entry.second.steps) {
+                    for (size_t i = 0; i < terms.size(); i++) {
+                        file << (i ? " " : "") << terms[i];
+                    }
+                    file << '\n';
+                }
+            }
+        }
+        filesystem::rename(temporaryPath, indexPath);
+        dirty = false;
     }
 
-   
+    // Pașii care conțin toate cuvintele din interogare; fiecare cuvânt se potrivește și ca prefix
+    vector<Match> search(const string& query) {
+        ensureLoaded();
+        vector<string> words;
+        TermSink sink(words);
+        sink << query;
+        sink.finish();
+        if (words.empty()) {
+            return {};
+        }
 
-  void run(Step& step, int stepIndex) {
-    try {
-        analytics.start();
-        cout << "Do you want to skip this step? (Press 's' to skip, Enter to continue): ";
-        char choice;
-        cin.get(choice);
+        // Perechi (flow, pas) sortate; fiecare cuvânt nou păstrează doar pașii comuni
+        auto byDocument = [](const Posting& a, const Posting& b) {
+            return a.document != b.document ? a.document < b.document : a.step < b.step;
+        };
+        auto same = [](const Posting& a, const Posting& b) {
+            return a.document == b.document && a.step == b.step;
+        };
+        vector<Posting> result;
+        for (size_t w = 0; w < words.size(); w++) {
+            vector<Posting> found;
+            for (auto it = postings.lower_bound(words[w]);
+                 it != postings.end() && it->first.compare(0, words[w].size(), words[w]) == 0; ++it) {
+                found.insert(found.end(), it->second.begin(), it->second.end());
+            }
+            sort(found.begin(), found.end(), byDocument);
+            found.erase(unique(found.begin(), found.end(), same), found.end());
+
+            if (w == 0) {
+                result = move(found);
+            } else {
+                vector<Posting> common;
+                set_intersection(result.begin(), result.end(), found.begin(), found.end(),
+                                 back_inserter(common), byDocument);
+                result = move(common);
+            }
+        }
 
-        if (choice == 's' || choice == 'S') {
-            cout << "Step skipped ! " << '\n';
-            analytics.skip(stepIndex);
-            return;
-        } else if (choice == '\n') {
-            step.execute();
+        vector<Match> matches;
+        for (const Posting& posting : result) {
+            if (matches.empty() || matches.back().flow != names[posting.document]) {
+                matches.push_back({names[posting.document], {}});
+            }
+            matches.back().steps.push_back(posting.step + 1);
         }
-    } catch (const std::exception& e) {
-        cout << "Error executing step: " << e.what() << '\n';
-        analytics.error(stepIndex);
+        sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) { return a.flow < b.flow; });
+        return matches;
     }
-    analytics.complete();
-}
-    
-    
-    Step* getStep(int index) const {
-        if (index >= 0 && index < stepCount) {
-            return steps[index];
-        } else {
-            return nullptr;
+};
+
+
+// Înregistrarea unei rulări: fiecare linie primită de pași (alegeri de skip, date, conținut
+// de fișiere), împreună cu timpul scurs de la linia anterioară
+struct Transcript {
+    struct Entry {
+        long long delayUs;
+        string line;
+    };
+    string flowName;
+    vector<Entry> entries;
+
+    void save(const string& path) const {
+        ofstream file(path);
+        if (!file) {
+            throw runtime_error("Could not open file for writing: " + path);
+        }
+        file << "TRANSCRIPT 1 " << flowName << '\n';
+        for (const Entry& entry : entries) {
+            file << entry.delayUs << '\t' << entry.line << '\n';
         }
     }
 
-    void printSteps() const {
-        for (int i = 0; i < stepCount; i++) {
-            cout << steps[i]->getDescription() << '\n';
+    static Transcript load(const string& path) {
+        ifstream file(path);
+        string header, version;
+        Transcript transcript;
+        if (!(file >> header >> version) || header != "TRANSCRIPT" || version != "1") {
+            throw runtime_error("Invalid transcript: " + path);
+        }
+        file.ignore(1);
+        readLine(file, transcript.flowName);
+
+        string line;
+        while (readLine(file, line)) {
+            size_t tab = line.find('\t');
+            if (tab == string::npos) {
+                throw runtime_error("Invalid transcript line in " + path);
+            }
+            transcript.entries.push_back({stoll(line.substr(0, tab)), line.substr(tab + 1)});
         }
+        return transcript;
     }
+};
 
-    void viewAnalytics()
-    {
-        analytics.print();
+// Trece liniile mai departe de la altă sursă și le notează în transcript
+class RecordingInput : public InputSource {
+    InputSource& source;
+    Transcript& transcript;
+    chrono::steady_clock::time_point last = chrono::steady_clock::now();
+public:
+    RecordingInput(InputSource& source, Transcript& transcript) : source(source), transcript(transcript) {}
+
+    bool tryReadLine(string& line) override {
+        if (!source.tryReadLine(line)) {
+            return false;
+        }
+        auto now = chrono::steady_clock::now();
+        transcript.entries.push_back({chrono::duration_cast<chrono::microseconds>(now - last).count(), line});
+        last = now;
+        return true;
+    }
+    void waitForLine(coroutine_handle<> awaiting) override {
+        source.waitForLine(awaiting);
+    }
+};
+
+// Redă un transcript; rate 0 înseamnă fără pauze, altfel pauzele sunt împărțite la rate
+class ReplayInput : public InputSource {
+    const Transcript& transcript;
+    double rate;
+    size_t position = 0;
+    bool exhausted = false;
+    chrono::steady_clock::duration waited{};
+public:
+    ReplayInput(const Transcript& transcript, double rate) : transcript(transcript), rate(rate) {}
+
+    bool tryReadLine(string& line) override {
+        if (position >= transcript.entries.size()) {
+            // Flow::run tratează excepția ca eroare a pasului, deci replay-ul verifică exhausted()
+            exhausted = true;
+            throw runtime_error("Transcript exhausted");
+        }
+        const Transcript::Entry& entry = transcript.entries[position++];
+        if (rate > 0 && entry.delayUs > 0) {
+            auto pause = chrono::microseconds(static_cast<long long>(entry.delayUs / rate));
+            this_thread::sleep_for(pause);
+            waited += pause;
+        }
+        line = entry.line;
+        return true;
+    }
+    void waitForLine(coroutine_handle<>) override {}
+
+    bool finished() const {
+        return position == transcript.entries.size();
+    }
+    // Rularea a cerut mai multe răspunsuri decât are transcriptul
+    bool wasExhausted() const {
+        return exhausted;
+    }
+    // După rulare: aruncă excepție dacă rularea s-a abătut de la transcript
+    void checkFollowed() const {
+        if (exhausted) {
+            throw runtime_error("Transcript ended before the run");
+        }
+        if (!finished()) {
+            throw runtime_error("Run ended before the transcript");
+        }
+    }
+    chrono::steady_clock::duration timeWaited() const {
+        return waited;
     }
+};
+
+struct ReplayOptions {
+    int jobs = max(1u, thread::hardware_concurrency());
+    double rate = 0;
+    int repeat = 1;
+    // Fiecare job scrie fișierele pașilor în "<outputDirectory>/job-<n>", ca joburile să nu se suprascrie
+    string outputDirectory = "replay";
+};
+
+// Numărul de alocări făcute și eliberate prin operator new/delete. Se numără doar cât timp
+// enabled este true (în testul de anduranță); altfel costul este un singur load relaxat.
+struct AllocationStats {
+    static inline atomic<bool> enabled{false};
+    static inline atomic<long long> allocated{0};
+    static inline atomic<long long> freed{0};
 
+    static long long live() {
+        return allocated.load(memory_order_relaxed) - freed.load(memory_order_relaxed);
+    }
 };
 
+void* operator new(size_t size) {
+    if (AllocationStats::enabled.load(memory_order_relaxed)) {
+        AllocationStats::allocated.fetch_add(1, memory_order_relaxed);
+    }
+    if (void* memory = malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw bad_alloc();
+}
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+void operator delete(void* memory) noexcept {
+    if (memory && AllocationStats::enabled.load(memory_order_relaxed)) {
+        AllocationStats::freed.fetch_add(1, memory_order_relaxed);
+    }
+    free(memory);
+}
+void operator delete[](void* memory) noexcept {
+    operator delete(memory);
+}
+void operator delete(void* memory, size_t) noexcept {
+    operator delete(memory);
+}
+void operator delete[](void* memory, size_t) noexcept {
+    operator delete(memory);
+}
+
+// Memoria rezidentă a procesului, în octeți; -1 dacă nu se poate afla
+long long residentMemory() {
+#ifdef __linux__
+    ifstream statm("/proc/self/statm");
+    long long size, resident;
+    if (statm >> size >> resident) {
+        return resident * sysconf(_SC_PAGESIZE);
+    }
+#endif
+    return -1;
+}
+
+// Generează un flow valid cu "steps" pași (ultimul este EndStep), în formatul din "flows/*.txt".
+// mix dă ponderea fiecărui tip de pas, ex. "title=1,text=2,number=2,calc=2,display=1,output=1".
+// Operanzii pașilor de calcul sunt pași numerici anteriori, iar pașii de afișare folosesc
+// fișierele din displayFiles.
+void generateFlow(ostream& file, const string& name, long long steps, const string& mix,
+                  const vector<string>& displayFiles, unsigned seed) {
+    enum Kind { Title, Text, Input, Number, Calc, Display, TextFile, Csv, Output, KindCount };
+    static const char* kindNames[KindCount] = {
+        "title", "text", "input", "number", "calc", "display", "textfile", "csv", "output"};
+    double weights[KindCount] = {1, 2, 1, 2, 2, 1, 0, 0, 1};
+
+    stringstream spec(mix);
+    string item;
+    while (getline(spec, item, ',')) {
+        size_t equals = item.find('=');
+        const char** kind = find(kindNames, kindNames + KindCount, item.substr(0, equals));
+        if (equals == string::npos || kind == kindNames + KindCount) {
+            throw runtime_error("Invalid step mix: " + item);
+        }
+        weights[kind - kindNames] = max(0.0, atof(item.c_str() + equals + 1));
+    }
+    if (weights[Display] > 0 && displayFiles.empty()) {
+        throw runtime_error("Display steps need at least one file in fisiere");
+    }
+    if (steps < 1 || steps > numeric_limits<int>::max()) {
+        throw runtime_error("Invalid number of steps: " + to_string(steps));
+    }
+
+    static const char* words[] = {"report", "budget", "invoice", "customer", "summary", "total",
+                                  "price", "order", "quarter", "review", "monthly", "account"};
+    mt19937 generator(seed);
+    discrete_distribution<int> pickKind(weights, weights + KindCount);
+    auto word = [&]() { return words[generator() % size(words)]; };
+
+    file << name << '\n' << steps << '\n';
+    vector<int> numeric; // pașii care produc un număr, operanzi valizi pentru CalculusStep
+    for (long long i = 1; i < steps; i++) {
+        int kind = pickKind(generator);
+        if (kind == Calc && numeric.empty()) {
+            kind = Number;
+        }
+        if (kind == Output && i == 1) {
+            kind = Title; // Nu există încă un pas anterior de referit
+        }
+        switch (kind) {
+            case Title:
+                file << "TitleStep\n" << word() << ' ' << i << '\n' << word() << ' ' << word() << '\n';
+                break;
+            case Text:
+                file << "TextStep\n" << word() << ' ' << i << '\n' << word() << ' ' << word() << ' ' << word() << '\n';
+                break;
+            case Input:
+                file << "TextInputStep\nEnter the " << word() << '\n';
+                break;
+            case Number:
+                file << "NumberInputStep\nEnter the " << word() << '\n';
+                numeric.push_back(i);
+                break;
+            case Calc:
+                file << "CalculusStep\n" << "+-*/mM"[generator() % 6] << ' '
+                     << numeric[generator() % numeric.size()] << ' ' << numeric[generator() % numeric.size()] << '\n';
+                numeric.push_back(i);
+                break;
+            case Display:
+                file << "DisplayStep\n" << displayFiles[generator() % displayFiles.size()] << '\n';
+                break;
+            case TextFile:
+                file << "TextFileInputStep\nWrite the " << word() << '\n';
+                break;
+            case Csv:
+                file << "CSVFileInputStep\nFill in the " << word() << '\n';
+                break;
+            case Output:
+                // Câteva fișiere refolosite, nu câte unul pentru fiecare pas
+                file << "OutputStep\n" << (generator() % (i - 1) + 1) << '\n' << name << "-out" << i % 4 << '\n'
+                     << word() << ' ' << i << '\n' << word() << ' ' << word() << "\n\n";
+                break;
+        }
+    }
+    file << "EndStep\nEnd step\n";
+}
+
+// Răspunsurile pe care le-ar da un utilizator care rulează flowul până la capăt fără să sară pași
+Transcript answersFor(const Flow& flow, const string& fileDirectory) {
+    Transcript transcript;
+    transcript.flowName = flow.getName();
+    auto answer = [&](const string& line) { transcript.entries.push_back({0, line}); };
+    for (int i = 0; i < flow.getStepCount(); i++) {
+        answer(""); // Press Enter to execute
+        answer(""); // nu sare pasul
+        string_view type = flow.getStep(i)->typeName();
+        if (type == "NumberInputStep") {
+            answer(to_string(i % 9 + 1));
+        } else if (type == "TextInputStep") {
+            answer("soak");
+        } else if (type == "TextFileInputStep") {
+            answer(fileDirectory + "/" + flow.getName() + "-text");
+            answer("soak line");
+            answer("STOP");
+        } else if (type == "CSVFileInputStep") {
+            answer(fileDirectory + "/" + flow.getName() + "-csv");
+            answer("1");
+            answer("2");
+            answer("1.5");
+            answer("2.5");
+        }
+    }
+    return transcript;
+}
+
+#ifdef __linux__
+// Daemon care servește flowurile din store pe un socket Unix, folosind epoll.
+// Fiecare cadru are un antet de 4 octeți (lungimea, big-endian) urmat de comandă:
+//   LIST | DESCRIBE <flow> | START <flow> | ANSWER <text> | ANALYTICS <flow>
+// Răspunsuri: OK <text> | ERR <text> | OUT <text> | PROMPT | DONE
+// Totul rulează pe un singur fir: o sesiune care așteaptă un răspuns este o corutină suspendată,
+// iar un client care nu citește doar își adună răspunsurile în buffer, fără să blocheze firul.
+class FlowServer {
+    static constexpr uint32_t maxFrame = 1 << 20;        // o comandă mai lungă închide conexiunea
+    static constexpr size_t maxPendingOutput = 16 << 20; // la fel, răspunsurile necitite peste limită
+
+    struct Client {
+        int fd;
+        int epollFd;
+        string readBuffer;
+        string writeBuffer;
+        size_t written = 0; // cât din writeBuffer a plecat deja
+        bool waitingWritable = false;
+        bool failed = false; // conexiunea trebuie închisă
+
+        Client(int fd, int epollFd) : fd(fd), epollFd(epollFd) {}
+        ~Client() { close(fd); }
+
+        void send(const string& payload) {
+            if (failed) {
+                return;
+            }
+            uint32_t length = htonl(static_cast<uint32_t>(payload.size()));
+            writeBuffer.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            writeBuffer += payload;
+            if (writeBuffer.size() - written > maxPendingOutput) {
+                failed = true;
+                return;
+            }
+            flush();
+        }
+
+        // Trimite cât acceptă socketul acum; restul pleacă la EPOLLOUT
+        void flush() {
+            while (written < writeBuffer.size()) {
+                ssize_t n = ::send(fd, writeBuffer.data() + written, writeBuffer.size() - written, MSG_NOSIGNAL);
+                if (n > 0) {
+                    written += n;
+                } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    break;
+                } else if (n < 0 && errno == EINTR) {
+                    continue;
+                } else {
+                    failed = true;
+                    return;
+                }
+            }
+            if (written == writeBuffer.size()) {
+                writeBuffer.clear();
+                written = 0;
+            }
+            bool pending = !writeBuffer.empty();
+            if (pending != waitingWritable) {
+                epoll_event event{};
+                event.events = EPOLLIN;
+                if (pending) {
+                    event.events |= EPOLLOUT;
+                }
+                event.data.fd = fd;
+                epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+                waitingWritable = pending;
+            }
+        }
+    };
+
+    // Tot ce scrie un pas ajunge la client într-un singur cadru OUT, la golire
+    class SocketSink : public OutputSink {
+        Client& client;
+        string buffer = "OUT ";
+    public:
+        explicit SocketSink(Client& client) : client(client) {}
+        void write(string_view text) override {
+            buffer.append(text);
+        }
+        void flush() override {
+            if (buffer.size() > 4) {
+                client.send(buffer);
+                buffer.resize(4);
+            }
+        }
+    };
+
+    // Răspunsurile ANSWER; când nu există niciunul, clientul primește PROMPT și pasul se suspendă
+    class SessionInput : public InputSource {
+        deque<string> answers;
+        coroutine_handle<> waiting;
+        Client& client;
+        OutputSink& output;
+    public:
+        SessionInput(Client& client, OutputSink& output) : client(client), output(output) {}
+
+        bool tryReadLine(string& line) override {
+            if (answers.empty()) {
+                return false;
+            }
+            line = move(answers.front());
+            answers.pop_front();
+            return true;
+        }
+        void waitForLine(coroutine_handle<> awaiting) override {
+            output.flush();
+            client.send("PROMPT");
+            waiting = awaiting;
+        }
+        void push(const string& answer) {
+            answers.push_back(answer);
+            if (waiting) {
+                exchange(waiting, nullptr).resume();
+            }
+        }
+    };
+
+    // O rulare a unui flow; are propria copie a flowului, deci pașii nu sunt împărțiți între sesiuni.
+    // Membrii sunt distruși în ordine inversă: corutina suspendată dispare înaintea flowului.
+    struct Session {
+        string flowName;
+        unique_ptr<Flow> flow;
+        SocketSink output;
+        SessionInput input;
+        StepTask task;
+
+        Session(const string& flowName, Flow* flow, Client& client)
+            : flowName(flowName), flow(flow), output(client),
+              input(client, output), task(flow->runAll()) {
+            flow->setStreams(input, output);
+        }
+    };
+
+    struct Connection {
+        unique_ptr<Client> client;
+        unique_ptr<Session> session;
+    };
+
+    const FlowStore& store;
+    function<void(Flow&)> prepare;
+    int listenFd = -1;
+    int epollFd = -1;
+    map<int, Connection> connections;
+
+public:
+    FlowServer(const FlowStore& store, function<void(Flow&)> prepare) : store(store), prepare(move(prepare)) {}
+    FlowServer(const FlowServer&) = delete;
+    FlowServer& operator=(const FlowServer&) = delete;
+
+    ~FlowServer() {
+        connections.clear();
+        if (epollFd >= 0) close(epollFd);
+        if (listenFd >= 0) close(listenFd);
+    }
+
+    void serve(const string& socketPath) {
+        listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd < 0) {
+            throw runtime_error("Could not create socket");
+        }
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path)) {
+            throw runtime_error("Socket path too long: " + socketPath);
+        }
+        strcpy(address.sun_path, socketPath.c_str());
+        unlink(socketPath.c_str());
+        if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+            listen(listenFd, SOMAXCONN) < 0) {
+            throw runtime_error("Could not listen on " + socketPath);
+        }
+
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        watch(listenFd);
+        cout << "Serving flows on " << socketPath << endl;
+
+        epoll_event events[64];
+        while (true) {
+            int count = epoll_wait(epollFd, events, 64, -1);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            for (int i = 0; i < count; i++) {
+                int fd = events[i].data.fd;
+                if (fd == listenFd) {
+                    acceptClients();
+                    continue;
+                }
+                auto it = connections.find(fd);
+                if (it == connections.end()) {
+                    continue;
+                }
+                if (events[i].events & EPOLLOUT) {
+                    it->second.client->flush();
+                }
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    readClient(fd);
+                }
+                it = connections.find(fd);
+                if (it != connections.end() && it->second.client->failed) {
+                    disconnect(fd);
+                }
+            }
+        }
+    }
+
+private:
+    void watch(int fd) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+
+    void acceptClients() {
+        int fd;
+        while ((fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+            connections[fd].client = make_unique<Client>(fd, epollFd);
+            watch(fd);
+        }
+    }
+
+    void disconnect(int fd) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        connections.erase(fd);
+    }
+
+    // Cadrele sunt tratate după fiecare bucată citită, deci bufferul nu depășește un cadru maxim
+    void readClient(int fd) {
+        Connection& connection = connections[fd];
+        char buffer[4096];
+        while (!connection.client->failed) {
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n > 0) {
+                connection.client->readBuffer.append(buffer, n);
+                handleFrames(connection);
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                connection.client->failed = true;
+            }
+        }
+    }
+
+    void handleFrames(Connection& connection) {
+        string& data = connection.client->readBuffer;
+        size_t offset = 0;
+        while (data.size() - offset >= sizeof(uint32_t)) {
+            uint32_t length;
+            memcpy(&length, data.data() + offset, sizeof(length));
+            length = ntohl(length);
+            if (length > maxFrame) {
+                connection.client->send("ERR Frame too large");
+                connection.client->failed = true;
+                return;
+            }
+            if (data.size() - offset - sizeof(length) < length) {
+                break;
+            }
+            string payload = data.substr(offset + sizeof(length), length);
+            offset += sizeof(length) + length;
+            handle(connection, payload);
+        }
+        data.erase(0, offset);
+    }
+
+    void handle(Connection& connection, const string& payload) {
+        size_t space = payload.find(' ');
+        string command = payload.substr(0, space);
+        string argument = space == string::npos ? "" : payload.substr(space + 1);
+        Client& client = *connection.client;
+
+        if (command == "LIST") {
+            string list;
+            for (const string& name : store.names()) {
+                list += name + "\n";
+            }
+            client.send("OK " + list);
+        } else if (command == "DESCRIBE") {
+            const Flow* flow = store.find(argument);
+            if (flow == nullptr) {
+                client.send("ERR Flow not found");
+                return;
+            }
+            ostringstream oss;
+            flow->printSteps(oss);
+            client.send("OK " + oss.str());
+        } else if (command == "START") {
+            if (connection.session) {
+                client.send("ERR A flow is already running");
+                return;
+            }
+            Flow* flow = store.instantiate(argument);
+            if (flow == nullptr) {
+                client.send("ERR Flow not found");
+                return;
+            }
+            prepare(*flow);
+            connection.session = make_unique<Session>(argument, flow, client);
+            client.send("OK Executing the flow: " + argument);
+            connection.session->task.start();
+            finishIfDone(connection);
+        } else if (command == "ANSWER") {
+            if (!connection.session) {
+                client.send("ERR No flow is running");
+                return;
+            }
+            connection.session->input.push(argument);
+            finishIfDone(connection);
+        } else if (command == "ANALYTICS") {
+            if (store.find(argument) == nullptr) {
+                client.send("ERR Flow not found");
+                return;
+            }
+            ostringstream oss;
+            AnalyticsPipeline::instance().print(argument, oss);
+            client.send("OK " + oss.str());
+        } else {
+            client.send("ERR Unknown command: " + command);
+        }
+    }
+
+    // După ce corutina sesiunii s-a terminat, eliberează sesiunea
+    void finishIfDone(Connection& connection) {
+        Session& session = *connection.session;
+        if (!session.task.done()) {
+            return;
+        }
+        session.output.flush();
+        connection.client->send("DONE");
+        connection.session.reset();
+    }
+};
+#endif
 
 class ProcessBuilderMenu {
+    FlowStore store;
+    FlowIndex index{"flows", "flows.idx"};
+    unique_ptr<FlowPack> pack; // dacă este deschisă, flowurile sunt citite și scrise în arhivă
+    bool packCompression = true;
+    StepCache memo;
+    bool sharedAnalytics = false;
+    string recordDirectory;
+    int recordedRuns = 0;
+    // Tot ce afișează meniul trece prin același buffer ca pașii; se golește doar înainte
+    // de a aștepta un răspuns sau înainte de rapoartele scrise direct în cout
+    OutputSink& screen = TerminalSink::instance();
+
+    istream& answer() {
+        screen.flush();
+        return cin;
+    }
+
 public:
 void showMenu() {
     while (true) {
-        cout << "----- Process Builder Menu -----" << endl;
-        cout << "1. Create a new flow" << endl;
-        cout << "2. View existing flows" << endl;
-        cout << "3. Run a flow" << endl;
-        cout << "4. View Analystics " <<endl;
-        cout << "5. Delete a flow" << endl;
-        cout << "6. Exit" << endl;
-        cout << "Enter your choice: ";
+        screen << "----- Process Builder Menu -----" << '\n';
+        screen << "1. Create a new flow" << '\n';
+        screen << "2. View existing flows" << '\n';
+        screen << "3. Run a flow" << '\n';
+        screen << "4. View Analystics " << '\n';
+        screen << "5. Delete a flow" << '\n';
+        screen << "6. Search flows" << '\n';
+        screen << "7. Exit" << '\n';
+        screen << "Enter your choice: ";
         int choice;
-        cin >> choice;
+        answer() >> choice;
         cin.ignore();
         switch (choice) {
             case 1:
@@ -502,63 +4335,44 @@ void showMenu() {
                 deleteFlow();
                 break;
             case 6:
+                searchFlows();
+                break;
+            case 7:
+                if (memo.enabled()) {
+                    screen.flush();
+                    memo.printStats();
+                }
                 return;
             default:
-                cout << "Invalid choice" << endl;
+                screen << "Invalid choice" << '\n';
         }
     }
 }
 
 void saveFlowToFile(const Flow& flow) {
-    ofstream file("flows/" + flow.getName() + ".txt");
-    if (!file.is_open()) {
-        throw runtime_error("Could not open file for writing: " + flow.getName() + ".txt");
-    }
-
-    file << flow.getName() << '\n';
-    file << flow.getMaxSteps() << '\n';
-
-    for (int i = 0; i < flow.getStepCount(); i++) {
-        Step* step = flow.getStep(i);
-
-        // Verificăm tipul de pas și scriem eticheta corespunzătoare în fișier
-        if (dynamic_cast<TitleStep*>(step)) {
-            file << "TitleStep\n";
-        } 
-        else if (dynamic_cast<TextStep*>(step)) {
-            file << "TextStep\n";
-        } 
-        else if (dynamic_cast<TextInputStep*>(step)) {
-            file << "TextInputStep\n";
-        } 
-         else if (dynamic_cast<NumberInputStep*>(step)) {
-            file << "NumberInputStep\n";}
-
-        else if (dynamic_cast<CalculusStep<float>*>(step)) {
-            file << "CalculusStep\n";
-        }
-
-        else if (dynamic_cast<DisplayStep*>(step)) {
-            file << "DisplayStep\n";}
-            
-        else if (dynamic_cast<TextFileInputStep*>(step)) {
-            file << "TextFileInputStep\n";}
-        
-        else if (dynamic_cast<CSVFileInputStep*>(step)) {
-            file << "CSVFileInputStep\n";}
-
-        else if (dynamic_cast<OutputStep*>(step)) {
-            file << "OutputStep\n";}
-
-        else if (dynamic_cast<EndStep*>(step)) {
-            file << "EndStep\n";
-        }
-        else {
-            throw runtime_error("Unknown step type");
+    {
+        TraceSpan span("io", "save");
+        span.setDetail(flow.getName());
+        if (pack) {
+            ostringstream source;
+            saveFlow(source, flow);
+            pack->write(flow.getName(), source.str());
+        } else {
+            ofstream file("flows/" + flow.getName() + ".txt");
+            if (!file.is_open()) {
+                throw runtime_error("Could not open file for writing: " + flow.getName() + ".txt");
+            }
+            saveFlow(file, flow);
         }
+    }
 
-        // Scriem detaliile specifice pasului în fișier
-        file << step->getDescription() << '\n';
+    // Copia din store nu mai corespunde fișierului, va fi recitită de pe disc
+    store.remove(flow.getName());
+    // Flowul este deja salvat; indexul rămâne modificat în memorie și se salvează la următoarea actualizare
+    try {
+        index.update(flow);
+    } catch (const exception& e) {
+        cerr << "Search index not updated: " << e.what() << '\n';
     }
 }
 
@@ -571,27 +4385,34 @@ void viewAllFlows() {
     
     int index = 1; // Index pentru numerotare
 
+    if (pack) {
+        for (const string& name : pack->names()) {
+            screen << index++ << ". " << name << '\n';
+        }
+        return;
+    }
+
     for (const auto& entry : filesystem::directory_iterator(directoryPath)) {
         if (entry.is_regular_file()) {
             // Obținem numele fișierului fără extensie
             string fileName = entry.path().filename().stem().string();
 
             // Afișăm numărul și numele fișierului
-            cout << index++ << ". " << fileName << '\n';
+            screen << index++ << ". " << fileName << '\n';
         }
     }
 }
 
 
 void viewFlows() {
-    cout << "List with name of flows: " << endl;
+    screen << "List with name of flows: " << '\n';
     viewAllFlows();
     const string directoryPath = "flows";
 
     // Solicită utilizatorului să introducă numele flowului
-    cout << "Enter the name of the flow: ";
+    screen << "Enter the name of the flow: ";
     string name;
-    getline(cin, name);
+    getline(answer(), name);
 
     // Adaugă extensia ".txt" la numele flowului
     string fileName = name + ".txt";
@@ -600,13 +4421,28 @@ void viewFlows() {
     filesystem::path filePath = directoryPath + "/" + fileName;
 
     // Verifică dacă fișierul există
-    if (filesystem::exists(filePath)) {
+    string source;
+    bool found = false;
+    if (pack) {
+        try {
+            found = pack->read(name, source);
+        } catch (const exception& e) {
+            cerr << "Error reading the flow: " << e.what() << '\n';
+        }
+    } else if (filesystem::exists(filePath)) {
         ifstream file(filePath);
         if (!file) {
             throw runtime_error("Could not open file: " + fileName);
         }
+        ostringstream contents;
+        contents << file.rdbuf();
+        source = contents.str();
+        found = true;
+    }
+    if (found) {
+        istringstream file(source);
         
-        cout << "Flow Name: " << name << '\n';
+        screen << "Flow Name: " << name << '\n';
         string line;
         getline(file, line);
         getline(file, line);
@@ -615,113 +4451,124 @@ void viewFlows() {
             if (!line.empty()) {
                 // Read only the first two words from each line
                 istringstream iss(line);
-                cout << line << '\n';
+                screen << line << '\n';
             }
             
         }
     } else {
-        cout << "Flow not found\n";
+        screen << "Flow not found\n";
     }
 
-    cout << "Press enter to continue...";
-    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    screen << "Press enter to continue...";
+    answer().ignore(numeric_limits<streamsize>::max(), '\n');
 }
 
 void createFlow() {
-    cout << "Enter the name of the flow: ";
+    screen << "Enter the name of the flow: ";
     string name;
-    getline(cin, name);
-    cout << "Enter the maximum number of steps: ";
+    getline(answer(), name);
+    screen << "Enter the maximum number of steps: ";
     int maxSteps;
-    cin >> maxSteps;
+    answer() >> maxSteps;
     cin.ignore();
     Flow flow(name, maxSteps);
     while (true) {
-        cout << "----- Create Flow Menu -----" << endl;
-        cout << "1. Add a title step" << endl;
-        cout << "2. Add a text step" << endl;
-        cout << "3. Add a text input step" << endl;
-        cout << "4. Add a number input step" << endl;
-        cout << "5. Add a calculus step" << endl;
-        cout << "6. Add a display step" << endl;
-        cout << "7. Add a text file input step" << endl;
-        cout << "8. Add a CSV file input step" << endl;
-        cout << "9. Add an output step" << endl;
-        cout << "10. Add an end step" << endl;
-        cout << "Enter your choice: ";
+        screen << "----- Create Flow Menu -----" << '\n';
+        screen << "1. Add a title step" << '\n';
+        screen << "2. Add a text step" << '\n';
+        screen << "3. Add a text input step" << '\n';
+        screen << "4. Add a number input step" << '\n';
+        screen << "5. Add a calculus step" << '\n';
+        screen << "6. Add a display step" << '\n';
+        screen << "7. Add a text file input step" << '\n';
+        screen << "8. Add a CSV file input step" << '\n';
+        screen << "9. Add an output step" << '\n';
+        screen << "10. Add an end step" << '\n';
+        screen << "Enter your choice: ";
         int choice;
-        cin >> choice;
+        answer() >> choice;
         cin.ignore();
         switch (choice) {
             case 1: {
-                cout << "TITLE STEP\n";
-                cout << "Enter the title: ";
+                screen << "TITLE STEP\n";
+                screen << "Enter the title: ";
                 string title;
-                getline(cin, title);
-                cout << "Enter the subtitle: ";
+                getline(answer(), title);
+                screen << "Enter the subtitle: ";
                 string subtitle;
-                getline(cin, subtitle);
+                getline(answer(), subtitle);
                 flow.addStep(new TitleStep(title, subtitle));
                 break;
             }
             case 2: {
-                cout << "TEXT STEP\n";
-                cout << "Enter the title: ";
+                screen << "TEXT STEP\n";
+                screen << "Enter the title: ";
                 string title;
-                getline(cin, title);
-                cout << "Enter the copy: ";
+                getline(answer(), title);
+                screen << "Enter the copy: ";
                 string copy;
-                getline(cin, copy);
+                getline(answer(), copy);
                 flow.addStep(new TextStep(title, copy));
                 break;
             }
             case 3: {
-                cout << "TEXT INPUT STEP\n";
-                cout << "Enter the description: ";
+                screen << "TEXT INPUT STEP\n";
+                screen << "Enter the description: ";
                 string description;
-                getline(cin, description);
+                getline(answer(), description);
                 flow.addStep(new TextInputStep(description));
                 break;
             }
             case 4: {
-                cout<< "NUMBER INPUT STEP\n";	
-                cout << "Enter the description: ";
+                screen << "NUMBER INPUT STEP\n";	
+                screen << "Enter the description: ";
                 string description;
-                getline(cin, description);
+                getline(answer(), description);
                 flow.addStep(new NumberInputStep(description));
                 break;
             }
             case 5: {
                 // Adaugă un pas de tip CalculusStep la flux
-                cout << "CALCULUS STEP\n";
-                cout << "Enter the operation (+, -, *, /, min, max): ";
+                screen << "CALCULUS STEP\n";
+                screen << "Enter the operation (+, -, *, /, min, max): ";
                 char operation;
-                cin >> operation;
+                answer() >> operation;
                 cin.ignore();
 
                 int operand1Index, operand2Index;
-                cout << "Enter the index of the first operand step: ";
-                cin >> operand1Index;
+                screen << "Enter the index of the first operand step: ";
+                answer() >> operand1Index;
                 cin.ignore();
 
-                cout << "Enter the index of the second operand step: ";
-                cin >> operand2Index;
+                screen << "Enter the index of the second operand step: ";
+                answer() >> operand2Index;
                 cin.ignore();
 
+                screen << "Enter the numeric type (float, double, int64, decimal; Enter for float): ";
+                string numericType;
+                getline(answer(), numericType);
+
                 // Verifică dacă indicii operanzilor sunt valizi
                 if (operand1Index >= 1 && operand1Index <= flow.getStepCount() &&
                     operand2Index >= 1 && operand2Index <= flow.getStepCount()) {
                     // Adaugă un CalculusStep la flux
                     Step* operand1 = flow.getStep(operand1Index - 1);
                     Step* operand2 = flow.getStep(operand2Index - 1);
-                    flow.addStep(new CalculusStep<float>(operand1, operand2, operation));
+                    try {
+                        flow.addStep(makeCalculusStep(numericType, operation, operand1, operand2, operand1Index, operand2Index));
+                    } catch (const exception& e) {
+                        screen << "Invalid calculus step: " << e.what() << '\n';
+                        break;
+                    }
 
                     // Afișează informațiile în fișier
-                    ofstream file("flows/" + name + ".txt", ios::app);
-                    file << "CalculusStep " << operation << " " << operand1Index << " " << operand2Index << "\n";
-                    file.close();
+                    if (!pack) {
+                        ofstream file("flows/" + name + ".txt", ios::app);
+                        file << "CalculusStep " << operation << " " << operand1Index << " " << operand2Index << "\n";
+                        file.close();
+                    }
                 } else {
-                    cout << "Invalid operand indices" << endl;
+                    screen << "Invalid operand indices" << '\n';
                 }
 
                 break;
@@ -729,342 +4576,1267 @@ void createFlow() {
 
 
             case 6: {
-                cout << "DISPLAY STEP\n";
-                cout << "Enter the filename: ";
+                screen << "DISPLAY STEP\n";
+                screen << "Enter the filename: ";
                 string filename;
-                getline(cin, filename);
+                getline(answer(), filename);
                 flow.addStep(new DisplayStep(filename));
                 break;
             }
 
             case 7: {
-                cout << "TEXT FILE INPUT STEP\n";
-                cout << "Enter the description of text filename: ";
+                screen << "TEXT FILE INPUT STEP\n";
+                screen << "Enter the description of text filename: ";
                 string description;
-                getline(cin, description);
+                getline(answer(), description);
                 flow.addStep(new TextFileInputStep(description));
                 break;
             }
 
             case 8: {
-                cout << "CSV FILE INPUT STEP\n";
-                cout << "Enter the description of CSV filename: ";
+                screen << "CSV FILE INPUT STEP\n";
+                screen << "Enter the description of CSV filename: ";
                 string description;
-                getline(cin, description);
+                getline(answer(), description);
                 flow.addStep(new CSVFileInputStep(description));
                 break;
             }
 
             case 9: {
-                cout << "OUTPUT STEP\n";
-                cout << "Enter the step number: ";
+                screen << "OUTPUT STEP\n";
+                screen << "Enter the step number: ";
                 int step;
-                cin >> step;
+                answer() >> step;
                 cin.ignore();
-                cout << "Enter the filename: ";
+                screen << "Enter the filename: ";
                 string filename;
-                getline(cin, filename);
-                cout << "Enter the title: ";
+                getline(answer(), filename);
+                screen << "Enter the title: ";
                 string title;
-                getline(cin, title);
-                cout << "Enter the description: ";
+                getline(answer(), title);
+                screen << "Enter the description: ";
                 string description;
-                getline(cin, description);
+                getline(answer(), description);
                 flow.addStep(new OutputStep(step, filename, title, description, *flow.getStep(step - 1)));
                 break;
             }
 
             case 10:
-                cout << "END STEP\n";
+                screen << "END STEP\n";
                 flow.addStep(new EndStep());
-                saveFlowToFile(flow);  
+                try {
+                    saveFlowToFile(flow);
+                } catch (const exception& e) {
+                    screen << "Error saving flow: " << e.what() << '\n';
+                }
                 return;
             default:
-                cout << "Invalid choice" << endl;
+                screen << "Invalid choice" << '\n';
         }
     }
     saveFlowToFile(flow);
 
 }
 
-void runFlow() {
-    // Afișează toate flowurile disponibile
-    viewAllFlows();
+// Ia flowul din store dacă a fost încărcat la pornire, altfel îl citește de pe disc
+Flow* openFlow(const string& flowName) {
+    Flow* flow = loadFlowSource(flowName);
+    if (flow != nullptr) {
+        prepareFlow(*flow);
+    }
+    return flow;
+}
 
-    // Solicită utilizatorului să aleagă un nume pentru flow
-    cout << "Choose a name for the flow:\n";
-    string flowName;
-    getline(cin, flowName);
+// Opțiunile din linia de comandă care se aplică fiecărei rulări
+void prepareFlow(Flow& flow) {
+    if (memo.enabled()) {
+        flow.setCache(&memo);
+    }
+#ifndef _WIN32
+    if (sharedAnalytics) {
+        flow.shareAnalytics();
+    }
+#endif
+}
+
+Flow* loadFlowSource(const string& flowName) {
+    if (Flow* flow = store.instantiate(flowName)) {
+        return flow;
+    }
+    if (pack) {
+        string source;
+        if (!pack->read(flowName, source)) {
+            return nullptr;
+        }
+        istringstream iss(source);
+        return loadFlow(iss);
+    }
 
-    // Definirea căii și a numelui de fișier pentru flow
     const string directoryPath = "flows";
     string fileName = flowName + ".txt";
     filesystem::path filePath = directoryPath + "/" + fileName;
 
-    // Verifică dacă fișierul există
-    if (filesystem::exists(filePath)) {
-        ifstream file(filePath);
+    if (!filesystem::exists(filePath)) {
+        return nullptr;
+    }
+    ifstream file(filePath);
+    if (!file) {
+        throw runtime_error("Could not open file: " + fileName);
+    }
+    return loadFlow(file);
+}
+
+void warmUp() {
+    cout << "Warming up flows...\n";
+    if (pack) {
+        store.warmUp(*pack);
+    } else {
+        store.warmUp("flows");
+    }
+}
+
+// Citește și scrie flowurile într-o singură arhivă în loc de directorul "flows".
+// Indexul de căutare al arhivei este ținut lângă ea, în "<arhivă>.idx".
+void usePack(const string& path) {
+    pack = make_unique<FlowPack>(path);
+    pack->setCompression(packCompression);
+    index.usePack(pack.get(), path + ".idx");
+}
+
+void setPackCompression(bool enabled) {
+    packCompression = enabled;
+    if (pack) {
+        pack->setCompression(enabled);
+    }
+}
+
+// Copiază în arhivă toate flowurile din "flows"; fișierele rămân pe disc
+int importFlows() {
+    if (!pack) {
+        cerr << "No pack opened, use --pack <file>\n";
+        return 1;
+    }
+    using Clock = chrono::steady_clock;
+    auto start = Clock::now();
+    vector<pair<string, string>> flows;
+    int failed = 0;
+    for (const auto& entry : filesystem::directory_iterator("flows")) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".txt") {
+            continue;
+        }
+        string name = entry.path().stem().string();
+        ifstream file(entry.path(), ios::binary);
         if (!file) {
-            // Aruncă o excepție dacă nu se poate deschide fișierul
-            throw runtime_error("Could not open file: " + fileName);
+            cerr << "  " << name << ": could not open file\n";
+            failed++;
+            continue;
         }
+        ostringstream contents;
+        contents << file.rdbuf();
+        flows.emplace_back(name, contents.str());
+    }
+    try {
+        pack->write(flows);
+    } catch (const exception& e) {
+        cerr << "Pack error: " << e.what() << '\n';
+        return 1;
+    }
+    int imported = flows.size();
+    double ms = chrono::duration<double, milli>(Clock::now() - start).count();
+    cout << "Imported " << imported << " flows (" << failed << " failed) in " << ms << " ms\n";
+    pack->printStats();
+    return failed ? 1 : 0;
+}
 
-        cout << "Executing the flow: " << flowName << endl;
+void enableSharedAnalytics() {
+#ifndef _WIN32
+    sharedAnalytics = true;
+#else
+    cerr << "Shared analytics are not available on this platform\n";
+#endif
+}
 
-        // Citește numele flowului și numărul maxim de pași
-        file >> flowName;
-        int maxSteps;
-        file >> maxSteps;
-        file.ignore(); // Consumă caracterul newline
+void enableMemoization(size_t capacity) {
+    memo.setCapacity(capacity);
+}
 
-        // Creează flowul
-        Flow flow(flowName, maxSteps);
+// Rulează un flow pe toate rândurile unui CSV. bindingSpec leagă pașii de intrare de coloane,
+// ex. "2=1,3=price" (pasul 2 din coloana 1, pasul 3 din coloana cu antetul "price")
+int batch(const string& flowName, const string& dataPath, const string& bindingSpec, string outputPath) {
+    using Clock = chrono::steady_clock;
+    auto start = Clock::now();
 
-        // Citirea și adăugarea fiecărui pas în flow
-        while (!file.eof()) {
-            string stepType;
-            file >> stepType;
-            file.ignore(); // Consumă caracterul newline
+    Flow* flow = nullptr;
+    try {
+        flow = openFlow(flowName);
+        if (flow == nullptr) {
+            throw runtime_error("Flow not found: " + flowName);
+        }
 
-            if (stepType == "TitleStep") {
-                // Citirea datelor pentru pasul TitleStep și adăugarea la flow
-                string title, subtitle;
-                getline(file, title);
-                getline(file, subtitle);
-                TitleStep* step = new TitleStep(title, subtitle);
-                flow.addStep(step);
+        vector<pair<int, string>> bindings;
+        bool header = false;
+        stringstream spec(bindingSpec);
+        string item;
+        while (getline(spec, item, ',')) {
+            size_t equals = item.find('=');
+            if (equals == string::npos) {
+                throw runtime_error("Invalid binding: " + item);
+            }
+            string column = item.substr(equals + 1);
+            header = header || column.find_first_not_of("0123456789") != string::npos;
+            int step = 0;
+            auto parsed = from_chars(item.data(), item.data() + equals, step);
+            if (parsed.ec != errc() || parsed.ptr != item.data() + equals) {
+                throw runtime_error("Invalid binding: " + item);
+            }
+            if (step < 1 || step > flow->getStepCount()) {
+                throw runtime_error("Binding " + item + ": the flow has no step " + to_string(step));
+            }
+            if (!flow->getStep(step - 1)->isBatchInput()) {
+                throw runtime_error("Binding " + item + ": step " + to_string(step) + " (" +
+                                    string(flow->getStep(step - 1)->typeName()) + ") does not take input");
+            }
+            // Coloanele numerotate încep de la 1
+            if (!column.empty() && column.find_first_not_of('0') == string::npos) {
+                throw runtime_error("Unknown column: " + column);
+            }
+            bindings.push_back({step, column});
+        }
 
-            } else if (stepType == "TextStep") {
-                // Citirea datelor pentru pasul TextStep și adăugarea la flow
-                string title, copy;
-                getline(file, title);
-                getline(file, copy);
-                TextStep* step = new TextStep(title, copy);
-                flow.addStep(step);
+        ifstream data(dataPath);
+        if (!data) {
+            throw runtime_error("Could not open file: " + dataPath);
+        }
+        vector<vector<string>> table;
+        string line;
+        while (readLine(data, line)) {
+            if (line.find_first_not_of(" \t") == string::npos) {
+                continue;
+            }
+            vector<string> cells;
+            size_t begin = 0;
+            while (begin <= line.size()) {
+                size_t end = line.find(',', begin);
+                if (end == string::npos) {
+                    end = line.size();
+                }
+                size_t first = line.find_first_not_of(" \t", begin);
+                size_t last = line.find_last_not_of(" \t", end - 1);
+                if (first == string::npos || first >= end || end == begin) {
+                    cells.emplace_back();
+                } else {
+                    cells.emplace_back(line, first, last - first + 1);
+                }
+                begin = end + 1;
+            }
+            table.push_back(move(cells));
+        }
+        vector<string> columnNames;
+        if (header && !table.empty()) {
+            columnNames = table.front();
+            table.erase(table.begin());
+        }
 
-            } else if (stepType == "TextInputStep") {
-                // Citirea datelor pentru pasul TextInputStep și adăugarea la flow
-                string description;
-                getline(file, description);
-                TextInputStep* step = new TextInputStep(description);
-                flow.addStep(step);
+        BatchRun run;
+        run.rows = table.size();
+        size_t width = columnNames.size();
+        for (const auto& row : table) {
+            width = max(width, row.size());
+        }
+        for (const auto& binding : bindings) {
+            size_t column = width;
+            auto named = find(columnNames.begin(), columnNames.end(), binding.second);
+            if (named != columnNames.end()) {
+                column = named - columnNames.begin();
+            } else {
+                const string& number = binding.second;
+                auto parsed = from_chars(number.data(), number.data() + number.size(), column);
+                if (parsed.ec != errc() || parsed.ptr != number.data() + number.size()) {
+                    column = width;
+                } else {
+                    column--;
+                }
+            }
+            if (column >= width) {
+                throw runtime_error("Unknown column: " + binding.second);
+            }
+            vector<string>& values = run.bindings[binding.first - 1];
+            values.reserve(run.rows);
+            for (const auto& row : table) {
+                values.push_back(column < row.size() ? row[column] : "");
+            }
+        }
 
-            } else if (stepType == "NumberInputStep") {
-                // Citirea datelor pentru pasul NumberInputStep și adăugarea la flow
-                string description;
-                getline(file, description);
-                NumberInputStep* step = new NumberInputStep(description);
-                flow.addStep(step);
+        flow->runBatch(run);
+        TerminalSink::instance().flush();
 
-            } else if (stepType == "CalculusStep") {
-                // Citirea datelor pentru pasul CalculusStep și adăugarea la flow
-                char operation;
-                file >> operation;
-                file.ignore();
+        // Rezultatele tuturor pașilor care produc valori, câte un rând pentru fiecare rând de intrare
+        if (outputPath.empty()) {
+            outputPath = flowName + "-batch.csv";
+        }
+        vector<pair<int, const vector<string>*>> columns;
+        for (int i = 0; i < flow->getStepCount(); i++) {
+            const vector<string>& values = run.text(flow->getStep(i));
+            if (!values.empty()) {
+                columns.push_back({i + 1, &values});
+            }
+        }
+        string content = "row";
+        for (const auto& column : columns) {
+            content += ",step" + to_string(column.first);
+        }
+        content += '\n';
+        for (size_t r = 0; r < run.rows; r++) {
+            content += to_string(r + 1);
+            for (const auto& column : columns) {
+                content += ',';
+                content += (*column.second)[r];
+            }
+            content += '\n';
+        }
+        ofstream output(outputPath, ios::binary);
+        if (!output) {
+            throw runtime_error("Could not open file for writing: " + outputPath);
+        }
+        output.write(content.data(), content.size());
+
+        double elapsed = chrono::duration<double>(Clock::now() - start).count();
+        cout << "Batch: " << run.rows << " rows in " << elapsed << " s (" << run.rows / elapsed << " rows/s), "
+             << run.errors << " errors, results in " << outputPath << '\n';
+    } catch (const exception& e) {
+        cerr << "Batch error: " << e.what() << '\n';
+        delete flow;
+        return 1;
+    }
+    delete flow;
+    return 0;
+}
 
-                int operand1Index, operand2Index;
-                file >> operand1Index >> operand2Index;
-                file.ignore();
+void setRecordDirectory(const string& directory) {
+    filesystem::create_directories(directory);
+    recordDirectory = directory;
+}
 
-                // Verifică dacă indicii operanzilor sunt valizi
-                if (operand1Index >= 1 && operand1Index <= flow.getStepCount() &&
-                    operand2Index >= 1 && operand2Index <= flow.getStepCount()) {
-                    Step* operand1 = flow.getStep(operand1Index - 1);
-                    Step* operand2 = flow.getStep(operand2Index - 1);
+// Redă în paralel transcripturile (un fișier .rec sau un director) și raportează
+// debitul și distribuția latențelor; latența nu include pauzele redate din transcript
+int replay(const string& path, const ReplayOptions& options) {
+    vector<Transcript> transcripts;
+    try {
+        if (filesystem::is_directory(path)) {
+            for (const auto& entry : filesystem::directory_iterator(path)) {
+                if (entry.is_regular_file() && entry.path().extension() == ".rec") {
+                    transcripts.push_back(Transcript::load(entry.path().string()));
+                }
+            }
+        } else {
+            transcripts.push_back(Transcript::load(path));
+        }
+    } catch (const exception& e) {
+        cerr << "Replay error: " << e.what() << '\n';
+        return 1;
+    }
+    if (transcripts.empty()) {
+        cerr << "No transcripts found in " << path << '\n';
+        return 1;
+    }
+    if (store.empty()) {
+        warmUp();
+    }
 
-                    flow.addStep(new CalculusStep<float>(operand1, operand2, operation));
+    using Clock = chrono::steady_clock;
+    size_t total = transcripts.size() * max(1, options.repeat);
+    vector<double> latencies(total, -1);
+    atomic<size_t> next(0);
+    atomic<int> failures(0);
+
+    for (int job = 0; job < options.jobs; job++) {
+        error_code ec;
+        filesystem::create_directories(options.outputDirectory + "/job-" + to_string(job), ec);
+        if (ec) {
+            cerr << "Replay error: could not create " << options.outputDirectory << ": " << ec.message() << '\n';
+            return 1;
+        }
+    }
 
-                } else {
-                    cout << "Invalid operand indices in CalculusStep" << endl;
+    auto worker = [&](int job) {
+        NullSink discard;
+        string jobDirectory = options.outputDirectory + "/job-" + to_string(job);
+        size_t i;
+        while ((i = next.fetch_add(1)) < total) {
+            const Transcript& transcript = transcripts[i % transcripts.size()];
+            Flow* flow = nullptr;
+            auto start = Clock::now();
+            try {
+                flow = openFlow(transcript.flowName);
+                if (flow == nullptr) {
+                    throw runtime_error("Flow not found: " + transcript.flowName);
                 }
-            } else if (stepType == "DisplayStep") {
-                // Citirea datelor pentru pasul DisplayStep și adăugarea la flow
-                string filename;
-                getline(file, filename);
-                DisplayStep* step = new DisplayStep(filename);
-                flow.addStep(step);
+                ReplayInput input(transcript, options.rate);
+                flow->setStreams(input, discard);
+                flow->setOutputDirectory(jobDirectory);
+                runToCompletion(flow->runAll());
+                input.checkFollowed();
+                latencies[i] = chrono::duration<double, milli>(Clock::now() - start - input.timeWaited()).count();
+            } catch (const exception& e) {
+                if (failures++ == 0) {
+                    cerr << "Replay of " << transcript.flowName << " diverged: " << e.what() << '\n';
+                }
+            }
+            delete flow;
+        }
+    };
 
-            } else if (stepType == "TextFileInputStep") {
-                // Citirea datelor pentru pasul TextFileInputStep și adăugarea la flow
-                string description;
-                getline(file, description);
-                TextFileInputStep* step = new TextFileInputStep(description);
-                flow.addStep(step);
+    auto start = Clock::now();
+    vector<thread> threads;
+    for (int t = 1; t < options.jobs; t++) {
+        threads.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto& t : threads) {
+        t.join();
+    }
+    double elapsed = chrono::duration<double>(Clock::now() - start).count();
+
+    latencies.erase(remove(latencies.begin(), latencies.end(), -1.0), latencies.end());
+    sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        return latencies.empty() ? 0.0 : latencies[min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))];
+    };
+
+    cout << "Replays: " << total << " (" << failures << " failed) with " << options.jobs << " jobs in " << elapsed << " s\n";
+    cout << "Throughput: " << total / elapsed << " runs/s\n";
+    cout << "Latency (ms): p50 " << percentile(0.50) << ", p90 " << percentile(0.90)
+         << ", p99 " << percentile(0.99) << ", max " << (latencies.empty() ? 0.0 : latencies.back()) << '\n';
+    if (memo.enabled()) {
+        memo.printStats();
+    }
+    return failures == 0 ? 0 : 2;
+}
 
-            } else if (stepType == "CSVFileInputStep") {
-                // Citirea datelor pentru pasul CSVFileInputStep și adăugarea la flow
-                string description;
-                getline(file, description);
-                CSVFileInputStep* step = new CSVFileInputStep(description);
-                flow.addStep(step);
+// Scrie "flows/<name>.txt" cu un flow generat; vezi generateFlow
+int generate(const string& name, long long steps, const string& mix, unsigned seed) {
+    auto start = chrono::steady_clock::now();
+    try {
+        vector<string> displayFiles;
+        error_code ec;
+        for (const auto& entry : filesystem::directory_iterator("fisiere", ec)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".txt") {
+                displayFiles.push_back(entry.path().stem().string());
+            }
+        }
+        sort(displayFiles.begin(), displayFiles.end());
 
-            } else if (stepType == "OutputStep") {
-                // Citirea datelor pentru pasul OutputStep și adăugarea la flow
-                int s;
-                string filename1, title, description;
-                file >> s;
-                file.ignore();
-                getline(file, filename1);
-                getline(file, title);
-                getline(file, description);
-                OutputStep* step = new OutputStep(s, filename1, title, description, *flow.getStep(s-1));
-                flow.addStep(step);
+        string path = "flows/" + name + ".txt";
+        {
+            ofstream file(path, ios::binary);
+            if (!file) {
+                throw runtime_error("Could not open file for writing: " + path);
+            }
+            generateFlow(file, name, steps, mix, displayFiles, seed);
+            if (!file.flush()) {
+                throw runtime_error("Could not write " + path);
+            }
+        }
+        store.remove(name);
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "Generated " << path << ": " << steps << " steps, " << filesystem::file_size(path)
+             << " bytes in " << elapsed << " s\n";
+    } catch (const exception& e) {
+        cerr << "Generate error: " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
 
-            } else if (stepType == "EndStep") {
-                // Nu există conținut după EndStep, deci nu este nevoie să se citească nimic
-                flow.addStep(new EndStep());
+// Test de anduranță: încarcă, rulează fără utilizator și salvează flowurile (un nume din "flows"
+// sau un director de flowuri) în buclă, timp de "seconds" secunde. Fiecare salvare din "soak/" este
+// citită la următoarea rulare. La fiecare "reportEvery" secunde afișează debitul, memoria rezidentă
+// și alocările; după prima perioadă (încălzirea), alocările vii nu ar trebui să mai crească.
+int soak(const string& path, double seconds, double reportEvery) {
+    using Clock = chrono::steady_clock;
+    const string scratchDirectory = "soak";
+
+    struct SoakFlow {
+        string name;
+        string path;
+        Transcript answers;
+    };
+    vector<SoakFlow> flows;
+    if (filesystem::is_directory(path)) {
+        for (const auto& entry : filesystem::directory_iterator(path)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".txt") {
+                flows.push_back({entry.path().stem().string(), entry.path().string(), {}});
             }
         }
+    } else if (filesystem::exists("flows/" + path + ".txt")) {
+        flows.push_back({path, "flows/" + path + ".txt", {}});
+    }
+    if (flows.empty()) {
+        cerr << "No flows found for " << path << '\n';
+        return 1;
+    }
+    filesystem::create_directories(scratchDirectory);
+
+    AllocationStats::enabled = true;
+    NullSink discard;
+    long long runs = 0, steps = 0, failures = 0;
+    long long reportedRuns = 0, reportedSteps = 0, reportedAllocations = 0;
+    long long baselineLive = -1, baselineResident = -1;
+    auto start = Clock::now();
+    auto lastReport = start;
+
+    auto report = [&](Clock::time_point now) {
+        double interval = chrono::duration<double>(now - lastReport).count();
+        long long allocations = AllocationStats::allocated.load();
+        long long intervalRuns = runs - reportedRuns;
+        cout << "[" << static_cast<long long>(chrono::duration<double>(now - start).count()) << " s] "
+             << runs << " runs (" << intervalRuns / interval << " runs/s, "
+             << (steps - reportedSteps) / interval << " steps/s), RSS "
+             << residentMemory() / (1024.0 * 1024.0) << " MB, live allocations " << AllocationStats::live()
+             << ", " << (intervalRuns ? (allocations - reportedAllocations) / intervalRuns : 0)
+             << " allocations/run" << endl;
+        if (baselineLive < 0) {
+            baselineLive = AllocationStats::live();
+            baselineResident = residentMemory();
+        }
+        reportedRuns = runs;
+        reportedSteps = steps;
+        reportedAllocations = allocations;
+        lastReport = now;
+    };
+
+    while (chrono::duration<double>(Clock::now() - start).count() < seconds) {
+        for (SoakFlow& soakFlow : flows) {
+            Flow* flow = nullptr;
+            try {
+                ifstream file(soakFlow.path);
+                if (!file) {
+                    throw runtime_error("Could not open file: " + soakFlow.path);
+                }
+                flow = loadFlow(file);
+                prepareFlow(*flow);
+                if (soakFlow.answers.entries.empty()) {
+                    soakFlow.answers = answersFor(*flow, scratchDirectory);
+                }
 
-        // Rulează fiecare pas din flow
-        for (int i = 0; i < flow.getStepCount(); i++) {
-            Step* step = flow.getStep(i);
-            cout << "Press Enter to execute Step " << i + 1 << "...";
-            cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-            flow.run(*step, i);
+                ReplayInput input(soakFlow.answers, 0);
+                flow->setStreams(input, discard);
+                runToCompletion(flow->runAll());
+                if (!input.finished()) {
+                    throw runtime_error("Run ended before all answers were used");
+                }
+
+                soakFlow.path = scratchDirectory + "/" + soakFlow.name + ".txt";
+                ofstream saved(soakFlow.path);
+                saveFlow(saved, *flow);
+                if (!saved.flush()) {
+                    throw runtime_error("Could not write " + soakFlow.path);
+                }
+                steps += flow->getStepCount();
+                runs++;
+            } catch (const exception& e) {
+                if (failures++ == 0) {
+                    cerr << "Soak run of " << soakFlow.name << " failed: " << e.what() << '\n';
+                }
+            }
+            delete flow;
+        }
+        auto now = Clock::now();
+        if (chrono::duration<double>(now - lastReport).count() >= reportEvery) {
+            report(now);
         }
+    }
+    if (runs > reportedRuns || baselineLive < 0) {
+        report(Clock::now());
+    }
+    AllocationStats::enabled = false;
 
-        // Afișează analiticele flowului
-        flow.viewAnalytics();
-     } else {
-        cout << "Flow not found\n";
+    long long liveGrowth = AllocationStats::live() - baselineLive;
+    cout << "Soak: " << runs << " runs, " << failures << " failed; since warm-up RSS changed by "
+         << (residentMemory() - baselineResident) / 1024.0 << " KB and live allocations by " << liveGrowth << '\n';
+    if (memo.enabled()) {
+        memo.printStats();
     }
+    // Cu memoizarea activă, cache-ul poate crește legitim până la capacitate
+    bool leaked = liveGrowth > 0 && !memo.enabled();
+    if (leaked) {
+        cout << "Live allocations grew after warm-up: possible leak\n";
+    }
+    return failures == 0 && !leaked ? 0 : 2;
 }
 
-void viewAnalytics() {
+// Modul daemon: flowurile rămân încărcate și sunt rulate pentru mai mulți clienți
+int serve(const string& socketPath) {
+#ifdef __linux__
+    if (store.empty()) {
+        warmUp();
+    }
+    try {
+        FlowServer server(store, [this](Flow& flow) { prepareFlow(flow); });
+        server.serve(socketPath);
+    } catch (const exception& e) {
+        cerr << "Daemon error: " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+#else
+    cerr << "Daemon mode is only available on Linux\n";
+    return 1;
+#endif
+}
+
+void runFlow() {
+    // Afișează toate flowurile disponibile
     viewAllFlows();
 
-    cout << "Choose a name for the flow: \n";
+    // Solicită utilizatorului să aleagă un nume pentru flow
+    screen << "Choose a name for the flow:\n";
     string flowName;
-    getline(cin, flowName);
+    getline(answer(), flowName);
 
-    const string directoryPath = "flows";
-    string fileName = flowName + ".txt";
-    filesystem::path filePath = directoryPath + "/" + fileName;
+    Flow* flow;
+    try {
+        flow = openFlow(flowName);
+    } catch (const exception& e) {
+        screen << "Error loading flow: " << e.what() << '\n';
+        return;
+    }
+    if (flow == nullptr) {
+        screen << "Flow not found\n";
+        return;
+    }
 
-    if (filesystem::exists(filePath)) {
-        ifstream file(filePath);
-        if (!file) {
-            throw runtime_error("Could not open file: " + fileName);
+    // Progresul se salvează după fiecare pas; o rulare întreruptă poate fi reluată
+    Checkpoint checkpoint("checkpoints/" + flowName + ".ckpt");
+    int firstStep = 0;
+    try {
+        filesystem::create_directories("checkpoints");
+        int completed = checkpoint.open(*flow);
+        string resume;
+        if (completed > 0) {
+            screen << "A previous run of this flow stopped after step " << completed << ". Resume it? (y/n): ";
+            getline(answer(), resume);
         }
+        if (!resume.empty() && (resume[0] == 'y' || resume[0] == 'Y')) {
+            firstStep = checkpoint.restore(*flow);
+        } else {
+            checkpoint.reset();
+        }
+        flow->setCheckpoint(&checkpoint);
+    } catch (const exception& e) {
+        screen << "Run will not be checkpointed: " << e.what() << '\n';
+    }
 
-        // Read the flowName and maxSteps, but we don't need them for viewing analytics
-        file >> flowName;
-        int maxSteps;
-        file >> maxSteps;
-        file.ignore(); // Consume the newline character
-
-        Flow flow(flowName, maxSteps);
+    // Replay-ul pornește mereu de la primul pas, deci o rulare reluată nu poate fi redată
+    bool recording = !recordDirectory.empty();
+    if (recording && firstStep > 0) {
+        screen << "Resumed runs are not recorded\n";
+        recording = false;
+    }
 
-        
-        while (!file.eof()) {
-            string stepType;
-            file >> stepType;
-            file.ignore(); // Consume the newline character
+    screen << "Executing the flow: " << flowName << '\n';
 
-            if (stepType == "TitleStep") {
-                string title;
-                getline(file, title);
-                string subtitle;
-                getline(file, subtitle);
-                TitleStep* step = new TitleStep(title, subtitle);
-                flow.addStep(step);
+    Transcript transcript;
+    transcript.flowName = flowName;
+    RecordingInput recorder(ConsoleInput::instance(), transcript);
+    if (recording) {
+        flow->setStreams(recorder, TerminalSink::instance());
+    }
 
-            } else if (stepType == "TextStep") {
-                string title1;
-                getline(file, title1);
-                string copy;
-                getline(file, copy);
-                TextStep* step = new TextStep(title1, copy);
-                flow.addStep(step);
+    // Rulează fiecare pas din flow; pe consolă pașii nu se suspendă
+    try {
+        runToCompletion(flow->runAll(firstStep));
+    } catch (const exception& e) {
+        screen << "Error running flow: " << e.what() << '\n';
+    }
 
-            } else if (stepType == "TextInputStep") {
-                string description;
-                getline(file, description);
-                TextInputStep* step = new TextInputStep(description);
-                flow.addStep(step);
+    if (recording) {
+        string path = recordDirectory + "/" + flowName + "-" + to_string(time(nullptr)) +
+                      "-" + to_string(++recordedRuns) + ".rec";
+        try {
+            transcript.save(path);
+            screen << "Run recorded in " << path << '\n';
+        } catch (const exception& e) {
+            screen << "Error recording run: " << e.what() << '\n';
+        }
+    }
 
-            }else if (stepType == "NumberInputStep") {
-                string description;
-                getline(file, description);
-                NumberInputStep* step = new NumberInputStep(description);
-                flow.addStep(step);
+    // Afișează analiticele flowului
+    screen.flush();
+    flow->viewAnalytics();
+    delete flow;
+}
 
-            }else if (stepType == "DisplayStep") {
-                string filename;
-                getline(file, filename);
-                DisplayStep* step = new DisplayStep(filename);
-                flow.addStep(step);
+void viewAnalytics() {
+    viewAllFlows();
 
-            }else if (stepType == "TextFileInputStep") {
-                string description;
-                getline(file, description);
-                TextFileInputStep* step = new TextFileInputStep(description);
-                flow.addStep(step);
+    screen << "Choose a name for the flow: \n";
+    string flowName;
+    getline(answer(), flowName);
 
-            }else if (stepType == "CSVFileInputStep") {
-                string description;
-                getline(file, description);
-                CSVFileInputStep* step = new CSVFileInputStep(description);
-                flow.addStep(step);
+    Flow* flow;
+    try {
+        flow = openFlow(flowName);
+    } catch (const exception& e) {
+        screen << "Error loading flow: " << e.what() << '\n';
+        return;
+    }
+    if (flow == nullptr) {
+        screen << "Flow not found\n";
+        return;
+    }
 
-            }else if (stepType == "OutputStep") {
-                int s;
-                string filename1, title, description;
-                file >> s;
-                file.ignore();
-                getline(file, filename1);
-                getline(file, title);
-                getline(file, description);
-                OutputStep* step = new OutputStep(s, filename1, title, description, *flow.getStep(s-1));
-                flow.addStep(step);
+    // View the analytics for the flow
+    screen.flush();
+#ifndef _WIN32
+    if (sharedAnalytics) {
+        // Totalul live al tuturor proceselor care rulează flowul
+        flow->shareAnalytics()->print();
+        delete flow;
+        return;
+    }
+#endif
+    // Totalul rulărilor din acest proces
+    AnalyticsPipeline::instance().print(flowName);
+    delete flow;
+}
 
-            } else if (stepType == "EndStep") {
-                // No content after EndStep, so no need to read anything
-                flow.addStep(new EndStep());}
-            
+// Caută în indexul flowurilor, fără să deschidă fișierele din "flows"
+void search(const string& query) {
+    using Clock = chrono::steady_clock;
+    auto start = Clock::now();
+    if (index.ensureLoaded()) {
+        screen << "Index opened in " << chrono::duration<double, milli>(Clock::now() - start).count() << " ms\n";
+    }
+    start = Clock::now();
+    vector<FlowIndex::Match> matches = index.search(query);
+    double elapsed = chrono::duration<double, milli>(Clock::now() - start).count();
+
+    for (const auto& match : matches) {
+        screen << match.flow << ": step";
+        if (match.steps.size() > 1) {
+            screen << "s";
         }
+        for (size_t i = 0; i < match.steps.size(); i++) {
+            screen << (i ? ", " : " ") << match.steps[i];
+        }
+        screen << '\n';
+    }
+    screen << static_cast<long long>(matches.size()) << " flows found in " << elapsed << " ms\n";
+}
 
-        // Run each step, but don't execute the actual logic
-      
-        
-        // View the analytics for the flow
-        flow.viewAnalytics();
-    } else {
-        cout << "Flow not found\n";
+void searchFlows() {
+    screen << "Enter the words to search for: ";
+    string query;
+    getline(answer(), query);
+    try {
+        search(query);
+    } catch (const exception& e) {
+        screen << "Error searching flows: " << e.what() << '\n';
+    }
+    screen << "Press enter to continue...";
+    answer().ignore(numeric_limits<streamsize>::max(), '\n');
+}
+
+// Tot ce ține minte procesul despre un flow șters, ca unul nou cu același nume să pornească curat
+void forgetFlow(const string& name) {
+    store.remove(name);
+    try {
+        index.remove(name);
+    } catch (const exception& e) {
+        cerr << "Search index not updated: " << e.what() << '\n';
     }
+#ifndef _WIN32
+    SharedAnalytics::remove(name);
+#endif
 }
 
 void deleteFlow() {
-    cout << "Enter the name of the flow to delete: ";
+    screen << "Enter the name of the flow to delete: ";
     string name;
-    getline(cin, name);
+    getline(answer(), name);
 
     // Combinăm directorul curent cu subdirectorul "flows"
     string flowDirectory = "flows/";
     string filePath = flowDirectory + name + ".txt";
 
+    if (pack) {
+        if (pack->remove(name)) {
+            forgetFlow(name);
+            screen << "Flow '" << name << "' has been successfully deleted.\n";
+        } else {
+            screen << "Flow '" << name << "' not found.\n";
+        }
     // Folosim std::filesystem pentru a verifica dacă fișierul există
-    if (filesystem::exists(filePath)) {
+    } else if (filesystem::exists(filePath)) {
         // Ștergem fișierul dacă există
         try {
             filesystem::remove(filePath);
-            cout << "Flow '" << name << "' has been successfully deleted.\n";
+            forgetFlow(name);
+            screen << "Flow '" << name << "' has been successfully deleted.\n";
         } catch (const filesystem::filesystem_error& e) {
             cerr << "Error deleting the flow: " << e.what() << '\n';
         }
     } else {
         // Afisăm un mesaj în cazul în care fișierul nu a fost găsit
-        cout << "Flow '" << name << "' not found.\n";
+        screen << "Flow '" << name << "' not found.\n";
     }
-    cout << "Press enter to continue...";
-    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    screen << "Press enter to continue...";
+    answer().ignore(numeric_limits<streamsize>::max(), '\n');
 }
 
 };
 
-int main() {
+// Verificările rulate de --selftest, într-un director temporar: formatul flowurilor,
+// aritmetica zecimală, alocările la salvare, checkpoint-urile, arhiva de flowuri și replay-ul
+class SelfTest {
+    static constexpr const char* flowSource =
+        "selftest\n"
+        "6\n"
+        "TextInputStep\nname\n"
+        "NumberInputStep\na\n"
+        "NumberInputStep\nb\n"
+        "CalculusStep\n+ 2 3 decimal\n"
+        "OutputStep\n4\nresult\nResult\nSum of a and b\n0\n"
+        "EndStep\nEnd step\n";
+    // Valorile tastate trec prin pașii float, double și int64
+    static constexpr const char* numbersSource =
+        "numbers\n"
+        "6\n"
+        "NumberInputStep\na\n"
+        "NumberInputStep\nb\n"
+        "CalculusStep\n+ 1 2 float\n"
+        "CalculusStep\n* 1 2 double\n"
+        "CalculusStep\n+ 4 4 int64\n"
+        "EndStep\nEnd step\n";
+
+    string directory;
+    int failures = 0;
+
+    void check(bool condition, const string& what) {
+        if (!condition) {
+            cout << "  FAILED: " << what << '\n';
+            failures++;
+        }
+    }
+
+    unique_ptr<Flow> load(const char* text = flowSource) {
+        istringstream source(text);
+        unique_ptr<Flow> flow(loadFlow(source));
+        flow->setOutputDirectory(directory);
+        return flow;
+    }
+
+    // Răspunsurile unei rulări complete: Enter și "nu sar" pentru fiecare pas, plus datele
+    static Transcript answers(initializer_list<const char*> inputs = {"abc", "1.5", "2.25", "", "", ""}) {
+        Transcript transcript;
+        transcript.flowName = "selftest";
+        for (const char* input : inputs) {
+            transcript.entries.push_back({0, ""});
+            transcript.entries.push_back({0, ""});
+            if (*input) {
+                transcript.entries.push_back({0, input});
+            }
+        }
+        return transcript;
+    }
+
+    void decimals() {
+        auto value = [](string_view text) { return Numeric<Decimal>::parse(text); };
+        auto text = [](Decimal value) {
+            StringSink sink;
+            Numeric<Decimal>::write(sink, value);
+            return move(sink).str();
+        };
+        check(text(value("0.1") + value("0.2")) == "0.3", "0.1 + 0.2 == 0.3");
+        check(text(value("1234567.891") * value("1000")) == "1234567891", "1234567.891 * 1000");
+        check(text(value("1") / value("3")) == "0.333333", "1 / 3 rounded to 6 digits");
+        check(text(value("-2") / value("3")) == "-0.666667", "-2 / 3 rounded away from zero");
+        check(text(value("-0.0000005")) == "-0.000001", "parse rounds the 7th digit");
+        bool overflow = false;
+        try {
+            value("9000000000000") * value("9000000000000");
+        } catch (const runtime_error&) {
+            overflow = true;
+        }
+        check(overflow, "decimal overflow is reported");
+
+        auto fails = [](auto parse) {
+            try {
+                parse();
+            } catch (const runtime_error&) {
+                return true;
+            }
+            return false;
+        };
+        check(Numeric<float>::parse("+5") == 5 && Numeric<double>::parse("+2.5") == 2.5, "a leading + is accepted");
+        check(Numeric<int64_t>::parse("+7") == 7 && text(value("+1.5")) == "1.5", "a leading + is accepted");
+        check(Numeric<int64_t>::parse("1.5e3") == 1500, "int64 reads scientific notation");
+        check(fails([] { Numeric<int64_t>::parse("1.5e+20"); }), "1.5e+20 does not fit in int64");
+        check(fails([] { Numeric<int64_t>::parse("99999999999999999999"); }), "int64 range is checked");
+        check(fails([] { Numeric<float>::parse("1e40"); }), "1e40 does not fit in a float");
+        check(fails([] { Numeric<double>::parse("1e400"); }), "1e400 does not fit in a double");
+        check(fails([] { Numeric<float>::parse("abc"); }) && fails([] { Numeric<Decimal>::parse("abc"); }),
+              "text without digits is not a number");
+    }
+
+    void flowFormat() {
+        unique_ptr<Flow> flow = load();
+        ostringstream saved;
+        saveFlow(saved, *flow);
+        check(saved.str() == flowSource, "saveFlow writes back the loaded flow, OutputStep included");
+        unique_ptr<Flow> copy(flow->clone());
+        ostringstream cloned;
+        saveFlow(cloned, *copy);
+        check(cloned.str() == flowSource, "a cloned flow has the same definition");
+    }
+
+    // Un flux care scrie într-un buffer fix, ca salvarea măsurată să nu aloce din cauza fluxului
+    class FixedBuffer : public streambuf {
+        char data[4096];
+    public:
+        FixedBuffer() { rewind(); }
+        void rewind() { setp(data, data + sizeof(data)); }
+    };
+
+    // Salvarea și afișarea pașilor nu alocă nimic pe heap
+    void allocations() {
+        unique_ptr<Flow> flow = load();
+        FixedBuffer buffer;
+        ostream stream(&buffer);
+        char text[256];
+        BufferSink sink(text, sizeof(text));
+        constexpr int repeats = 1000;
+
+        AllocationStats::enabled = true;
+        long long before = AllocationStats::allocated.load();
+        for (int r = 0; r < repeats; r++) {
+            for (int i = 0; i < flow->getStepCount(); i++) {
+                const Step* step = flow->getStep(i);
+                sink.clear();
+                sink << step->typeName() << '\n';
+                step->describe(sink);
+                step->writeInfo(sink);
+            }
+            buffer.rewind();
+            saveFlow(stream, *flow);
+            flow->printSteps(stream);
+        }
+        long long allocated = AllocationStats::allocated.load() - before;
+        AllocationStats::enabled = false;
+        check(allocated == 0, to_string(allocated) + " allocations while saving and printing steps");
+    }
+
+    void run() {
+        unique_ptr<Flow> flow = load();
+        Transcript transcript = answers();
+        ReplayInput input(transcript, 0);
+        CaptureSink output;
+        flow->setStreams(input, output);
+        runToCompletion(flow->runAll());
+        input.checkFollowed();
+        check(flow->getStep(3)->getInfo() == "3.75", "1.5 + 2.25 == 3.75 in a decimal step");
+        ifstream result(directory + "/result.txt");
+        ostringstream written;
+        written << result.rdbuf();
+        check(written.str().find("Information from step 4: 3.75") != string::npos, "OutputStep writes the result");
+
+        // Rezultatele pașilor numerici, sau eroarea afișată de run
+        auto compute = [this](initializer_list<const char*> inputs) {
+            unique_ptr<Flow> numbers = load(numbersSource);
+            Transcript transcript = answers(inputs);
+            ReplayInput input(transcript, 0);
+            CaptureSink output;
+            numbers->setStreams(input, output);
+            runToCompletion(numbers->runAll());
+            input.checkFollowed();
+            return output.str();
+        };
+        string typed = compute({"+5", "+2", "", "", "", ""});
+        check(typed.find("Result: 7\n") != string::npos && typed.find("Result: 10\n") != string::npos &&
+              typed.find("Result: 20\n") != string::npos, "+5 and +2 compute as 5 and 2");
+        string large = compute({"1.5e20", "1", "", "", "", ""});
+        check(large.find("Result: 1.5e+20\n") != string::npos &&
+              large.find("Error executing step: Integer value out of range") != string::npos,
+              "1.5e+20 from a double step is out of range for int64");
+        string huge = compute({"1e40", "1", "", "", "", ""});
+        check(huge.find("Error executing step: Number out of range") != string::npos, "1e40 is out of range for float");
+    }
+
+    void replayDivergence() {
+        Transcript shorter = answers();
+        shorter.entries.resize(5);
+        unique_ptr<Flow> flow = load();
+        ReplayInput input(shorter, 0);
+        NullSink discard;
+        flow->setStreams(input, discard);
+        try {
+            runToCompletion(flow->runAll());
+        } catch (const exception&) {
+            // Ultima cerere de Enter nu mai are răspuns
+        }
+        check(input.wasExhausted(), "a short transcript is detected");
+
+        Transcript longer = answers();
+        longer.entries.push_back({0, "extra"});
+        flow = load();
+        ReplayInput extra(longer, 0);
+        flow->setStreams(extra, discard);
+        runToCompletion(flow->runAll());
+        bool diverged = false;
+        try {
+            extra.checkFollowed();
+        } catch (const runtime_error&) {
+            diverged = true;
+        }
+        check(diverged, "unused transcript lines are detected");
+    }
+
+    void checkpoints() {
+        string path = directory + "/selftest.ckpt";
+        {
+            unique_ptr<Flow> flow = load();
+            Checkpoint checkpoint(path);
+            check(checkpoint.open(*flow) == 0, "a new checkpoint is empty");
+            checkpoint.reset();
+            flow->setCheckpoint(&checkpoint);
+
+            // Răspunsurile primilor 4 pași: rularea se oprește înainte de pasul 5
+            Transcript transcript = answers();
+            transcript.entries.resize(11);
+            ReplayInput input(transcript, 0);
+            NullSink discard;
+            flow->setStreams(input, discard);
+            try {
+                runToCompletion(flow->runAll());
+            } catch (const exception&) {
+                // Ca un proces oprit: pașii terminați au rămas în checkpoint
+            }
+            check(input.wasExhausted(), "the run stops after step 4");
+
+            Checkpoint concurrent(path);
+            bool locked = false;
+            try {
+                concurrent.open(*flow);
+            } catch (const runtime_error&) {
+                locked = true;
+            }
+#ifndef _WIN32
+            check(locked, "a checkpoint in use cannot be opened again");
+#endif
+        }
+        unique_ptr<Flow> resumed = load();
+        Checkpoint checkpoint(path);
+        check(checkpoint.open(*resumed) == 4, "4 completed steps are read back");
+        check(checkpoint.restore(*resumed) == 4, "4 completed steps are restored");
+        check(resumed->getStep(0)->getInfo() == "abc", "text input is restored");
+        check(resumed->getStep(3)->getInfo() == "3.75", "calculus result is restored");
+
+        // Un checkpoint trunchiat în ultima înregistrare păstrează înregistrările întregi
+        string copy = path + ".copy";
+        filesystem::copy_file(path, copy);
+        filesystem::resize_file(copy, filesystem::file_size(copy) - 1);
+        Checkpoint truncated(copy);
+        unique_ptr<Flow> again = load();
+        check(truncated.open(*again) == 3, "a truncated checkpoint keeps the whole records");
+    }
+
+    void pack() {
+        string path = directory + "/selftest.pack";
+        mt19937 random(1);
+        string noise(40 * 1024, '\0');
+        {
+            FlowPack pack(path);
+            pack.write("small", flowSource);
+            pack.write("other", "other\n1\nEndStep\nEnd step\n");
+            // Blocuri care nu se comprimă, rescrise până când arhiva se compactează
+            for (int i = 0; i < 5; i++) {
+                for (char& c : noise) {
+                    c = static_cast<char>(random());
+                }
+                pack.write("noise", noise);
+            }
+            check(pack.remove("other"), "a flow is removed from the pack");
+        }
+        check(filesystem::file_size(path) < 2 * noise.size(), "a wasteful pack is compacted");
+
+        FlowPack reopened(path);
+        string source;
+        check(reopened.names() == vector<string>{"noise", "small"}, "the pack index is read back");
+        check(reopened.read("small", source) && source == flowSource, "a compressed flow is read back");
+        check(reopened.read("noise", source) && source == noise, "the last version of a rewritten flow is read back");
+        check(!reopened.read("other", source), "a removed flow stays removed");
+    }
+
+public:
+    int runAll() {
+        directory = (filesystem::temp_directory_path() / ("proba-selftest-" + to_string(random_device{}()))).string();
+        filesystem::create_directories(directory);
+        vector<pair<const char*, void (SelfTest::*)()>> tests = {
+            {"number parsing and decimal arithmetic", &SelfTest::decimals},
+            {"flow format", &SelfTest::flowFormat},
+            {"allocation-free save and print", &SelfTest::allocations},
+            {"flow run", &SelfTest::run},
+            {"replay divergence", &SelfTest::replayDivergence},
+            {"checkpoint round-trip", &SelfTest::checkpoints},
+            {"flow pack", &SelfTest::pack},
+        };
+        for (const auto& test : tests) {
+            int before = failures;
+            try {
+                (this->*test.second)();
+            } catch (const exception& e) {
+                cout << "  FAILED: " << e.what() << '\n';
+                failures++;
+            }
+            cout << (failures == before ? "ok     " : "FAILED ") << test.first << '\n';
+        }
+        error_code ec;
+        filesystem::remove_all(directory, ec);
+        return failures ? 1 : 0;
+    }
+};
+
+int main(int argc, char* argv[]) {
     ProcessBuilderMenu menu;
+    // Toate opțiunile se citesc întâi și se aplică apoi într-o ordine fixă,
+    // indiferent de ordinea din linia de comandă
+    string tracePath;
+    bool prefetch = true;
+    string packPath;
+    bool packCompression = true;
+    int memoCapacity = -1;
+    bool sharedAnalytics = false;
+    string recordDirectory;
+    bool warmup = false;
+    string daemonPath;
+    string replayPath;
+    ReplayOptions replayOptions;
+    vector<string> batchArgs;
+    string outputPath;
+    string searchQuery;
+    vector<string> generateArgs;
+    string mix;
+    unsigned seed = 1;
+    string soakPath;
+    double soakSeconds = 60, reportEvery = 10;
+    bool packImport = false;
+    bool selfTest = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--trace" && hasValue) {
+            tracePath = argv[++i];
+        } else if (arg == "--no-prefetch") {
+            prefetch = false;
+        } else if (arg == "--warmup") {
+            warmup = true;
+        } else if (arg == "--daemon" && hasValue) {
+            daemonPath = argv[++i];
+        } else if (arg == "--shared-analytics") {
+            sharedAnalytics = true;
+        } else if (arg == "--memo" && hasValue) {
+            memoCapacity = max(0, atoi(argv[++i]));
+        } else if (arg == "--record" && hasValue) {
+            recordDirectory = argv[++i];
+        } else if (arg == "--batch" && i + 3 < argc) {
+            batchArgs.assign(argv + i + 1, argv + i + 4);
+            i += 3;
+        } else if (arg == "--out" && hasValue) {
+            outputPath = argv[++i];
+        } else if (arg == "--generate" && i + 2 < argc) {
+            generateArgs.assign(argv + i + 1, argv + i + 3);
+            i += 2;
+        } else if (arg == "--mix" && hasValue) {
+            mix = argv[++i];
+        } else if (arg == "--seed" && hasValue) {
+            seed = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--soak" && i + 2 < argc) {
+            soakPath = argv[i + 1];
+            soakSeconds = atof(argv[i + 2]);
+            i += 2;
+        } else if (arg == "--report" && hasValue) {
+            reportEvery = max(0.1, atof(argv[++i]));
+        } else if (arg == "--pack" && hasValue) {
+            packPath = argv[++i];
+        } else if (arg == "--pack-uncompressed") {
+            packCompression = false;
+        } else if (arg == "--pack-import") {
+            packImport = true;
+        } else if (arg == "--search" && hasValue) {
+            searchQuery = argv[++i];
+        } else if (arg == "--replay" && hasValue) {
+            replayPath = argv[++i];
+        } else if (arg == "--jobs" && hasValue) {
+            replayOptions.jobs = max(1, atoi(argv[++i]));
+        } else if (arg == "--rate" && hasValue) {
+            replayOptions.rate = atof(argv[++i]);
+        } else if (arg == "--repeat" && hasValue) {
+            replayOptions.repeat = max(1, atoi(argv[++i]));
+        } else if (arg == "--replay-out" && hasValue) {
+            replayOptions.outputDirectory = argv[++i];
+        } else if (arg == "--selftest") {
+            selfTest = true;
+        }
+    }
+
+    if (!tracePath.empty()) {
+        Tracer::instance().open(tracePath);
+    }
+    Prefetcher::enabled.store(prefetch);
+    menu.setPackCompression(packCompression);
+    if (!packPath.empty()) {
+        try {
+            menu.usePack(packPath);
+        } catch (const exception& e) {
+            cerr << "Pack error: " << e.what() << '\n';
+            return 1;
+        }
+    }
+    if (memoCapacity >= 0) {
+        menu.enableMemoization(memoCapacity);
+    }
+    if (sharedAnalytics) {
+        menu.enableSharedAnalytics();
+    }
+    if (!recordDirectory.empty()) {
+        menu.setRecordDirectory(recordDirectory);
+    }
+    // După --pack, ca flowurile să fie încărcate din arhivă
+    if (warmup) {
+        menu.warmUp();
+    }
+
+    if (selfTest) {
+        return SelfTest().runAll();
+    }
+    if (!daemonPath.empty()) {
+        return menu.serve(daemonPath);
+    }
+    if (packImport) {
+        return menu.importFlows();
+    }
+    if (!generateArgs.empty()) {
+        return menu.generate(generateArgs[0], atoll(generateArgs[1].c_str()), mix, seed);
+    }
+    if (!soakPath.empty()) {
+        return menu.soak(soakPath, soakSeconds, reportEvery);
+    }
+    if (!searchQuery.empty()) {
+        try {
+            menu.search(searchQuery);
+        } catch (const exception& e) {
+            cerr << "Search error: " << e.what() << '\n';
+            return 1;
+        }
+        return 0;
+    }
+    if (!batchArgs.empty()) {
+        return menu.batch(batchArgs[0], batchArgs[1], batchArgs[2], outputPath);
+    }
+    if (!replayPath.empty()) {
+        return menu.replay(replayPath, replayOptions);
+    }
     menu.showMenu();
 
     return 0;